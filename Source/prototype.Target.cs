@@ -10,5 +10,10 @@ public class prototypeTarget : TargetRules
 		Type = TargetType.Game;
 		DefaultBuildSettings = BuildSettingsVersion.V2;
 		ExtraModuleNames.AddRange( new string[] { "prototype" } );
+
+		// Game state and player states mark their properties dirty instead of being compared every update.
+		// Push model changes engine defines, so the target needs its own build environment (source engine)
+		BuildEnvironment = TargetBuildEnvironment.Unique;
+		bWithPushModel = true;
 	}
 }
@@ -3,12 +3,12 @@
 #include "AI/BTTask_FindBotWaypoint.h"
 #include "AI/ShooterBotWaypoint.h"
 #include "AI/ShooterZombieAIController.h"
+#include "World/ShooterWaypointRegistry.h"
 /* AI Module includes */
 #include "BehaviorTree/BehaviorTreeComponent.h"
 #include "BehaviorTree/BlackboardComponent.h"
 /* This contains includes all key types like UBlackboardKeyType_Vector used below. */
 #include "BehaviorTree/Blackboard/BlackboardKeyAllTypes.h"
-#include "Kismet/GameplayStatics.h"
 
 
 EBTNodeResult::Type UBTTask_FindBotWaypoint::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
@@ -19,16 +19,14 @@ EBTNodeResult::Type UBTTask_FindBotWaypoint::ExecuteTask(UBehaviorTreeComponent&
 		return EBTNodeResult::Failed;
 	}
 
-	/* Iterate all the bot waypoints in the current level and find a new random waypoint to set as destination */
-	TArray<AActor*> AllWaypoints;
-	UGameplayStatics::GetAllActorsOfClass(MyController, AShooterBotWaypoint::StaticClass(), AllWaypoints);
-
-	if (AllWaypoints.Num() == 0)
+	UShooterWaypointRegistry* WaypointRegistry = MyController->GetWorld()->GetSubsystem<UShooterWaypointRegistry>();
+	if (WaypointRegistry == nullptr)
+	{
 		return EBTNodeResult::Failed;
+	}
 
-	/* Find a new waypoint randomly by index (this can include the current waypoint) */
-	/* For more complex or human AI you could add some weights based on distance and other environmental conditions here */
-	AActor* NewWaypoint = AllWaypoints[FMath::RandRange(0, AllWaypoints.Num() - 1)];
+	/* Find a new random waypoint among those registered in the level, close and uncrowded waypoints are more likely */
+	AActor* NewWaypoint = WaypointRegistry->PickWaypoint(MyController->GetPawn(), MyController->GetWaypoint());
 
 	/* Assign the new waypoint to the Blackboard */
 	if (NewWaypoint)
@@ -4,6 +4,7 @@
 #include "AI/BTTask_FindPatrolLocation.h"
 #include "AI/ShooterBotWaypoint.h"
 #include "AI/ShooterZombieAIController.h"
+#include "World/ShooterWaypointRegistry.h"
 
 /* AI Module includes */
 #include "BehaviorTree/BehaviorTreeComponent.h"
@@ -13,6 +14,11 @@
 #include "NavigationSystem.h"
 
 
+UBTTask_FindPatrolLocation::UBTTask_FindPatrolLocation()
+{
+	bUsePresampledPoints = true;
+}
+
 
 EBTNodeResult::Type UBTTask_FindPatrolLocation::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
 {
@@ -22,11 +28,20 @@ EBTNodeResult::Type UBTTask_FindPatrolLocation::ExecuteTask(UBehaviorTreeCompone
 		return EBTNodeResult::Failed;
 	}
 
-	AActor* MyWaypoint = MyController->GetWaypoint();
+	AShooterBotWaypoint* MyWaypoint = Cast<AShooterBotWaypoint>(MyController->GetWaypoint());
 	if (MyWaypoint)
 	{
+		UShooterWaypointRegistry* WaypointRegistry = MyController->GetWorld()->GetSubsystem<UShooterWaypointRegistry>();
+
+		FVector PatrolLocation;
+		if (bUsePresampledPoints && WaypointRegistry && WaypointRegistry->GetPatrolLocation(MyWaypoint, PatrolLocation))
+		{
+			OwnerComp.GetBlackboardComponent()->SetValue<UBlackboardKeyType_Vector>(BlackboardKey.GetSelectedKeyID(), PatrolLocation);
+			return EBTNodeResult::Succeeded;
+		}
+
 		/* Find a position that is close to the waypoint. We add a small random to this position to give build predictable patrol patterns  */
-		const float SearchRadius = 200.0f;
+		const float SearchRadius = MyWaypoint->PatrolRadius;
 		const FVector SearchOrigin = MyWaypoint->GetActorLocation();
 
 		FNavLocation ResultLocation;
@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI/BTTask_MoveAlongFlowField.h"
+#include "World/ShooterFlowFieldManager.h"
+
+/* AI Module includes */
+#include "AIController.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyAllTypes.h"
+
+
+UBTTask_MoveAlongFlowField::UBTTask_MoveAlongFlowField()
+{
+	NodeName = "Move Along Flow Field";
+	bNotifyTick = true;
+
+	AcceptableRadius = 100.0f;
+	SteeringLookahead = 200.0f;
+
+	/* Accept only actors as target */
+	BlackboardKey.AddObjectFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_MoveAlongFlowField, BlackboardKey), AActor::StaticClass());
+}
+
+
+EBTNodeResult::Type UBTTask_MoveAlongFlowField::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FBTMoveAlongFlowFieldMemory* MyMemory = reinterpret_cast<FBTMoveAlongFlowFieldMemory*>(NodeMemory);
+	MyMemory->bPathFallback = false;
+
+	AAIController* MyController = OwnerComp.GetAIOwner();
+	UBlackboardComponent* BlackboardComp = OwnerComp.GetBlackboardComponent();
+	if (MyController == nullptr || MyController->GetPawn() == nullptr || BlackboardComp == nullptr)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	AActor* TargetActor = Cast<AActor>(BlackboardComp->GetValue<UBlackboardKeyType_Object>(BlackboardKey.GetSelectedKeyID()));
+	if (TargetActor == nullptr)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	/* Steering happens in TickTask */
+	return EBTNodeResult::InProgress;
+}
+
+
+EBTNodeResult::Type UBTTask_MoveAlongFlowField::AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FBTMoveAlongFlowFieldMemory* MyMemory = reinterpret_cast<FBTMoveAlongFlowFieldMemory*>(NodeMemory);
+
+	AAIController* MyController = OwnerComp.GetAIOwner();
+	if (MyMemory->bPathFallback && MyController)
+	{
+		MyController->StopMovement();
+	}
+
+	return EBTNodeResult::Aborted;
+}
+
+
+void UBTTask_MoveAlongFlowField::TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds)
+{
+	FBTMoveAlongFlowFieldMemory* MyMemory = reinterpret_cast<FBTMoveAlongFlowFieldMemory*>(NodeMemory);
+
+	AAIController* MyController = OwnerComp.GetAIOwner();
+	APawn* MyPawn = MyController ? MyController->GetPawn() : nullptr;
+	UBlackboardComponent* BlackboardComp = OwnerComp.GetBlackboardComponent();
+	AActor* TargetActor = BlackboardComp ? Cast<AActor>(BlackboardComp->GetValue<UBlackboardKeyType_Object>(BlackboardKey.GetSelectedKeyID())) : nullptr;
+	if (MyPawn == nullptr || TargetActor == nullptr)
+	{
+		FinishLatentTask(OwnerComp, EBTNodeResult::Failed);
+		return;
+	}
+
+	const FVector PawnLocation = MyPawn->GetActorLocation();
+	if (FVector::DistSquared2D(PawnLocation, TargetActor->GetActorLocation()) <= FMath::Square(AcceptableRadius))
+	{
+		if (MyMemory->bPathFallback)
+		{
+			MyController->StopMovement();
+		}
+
+		FinishLatentTask(OwnerComp, EBTNodeResult::Succeeded);
+		return;
+	}
+
+	UShooterFlowFieldManager* FlowFields = MyPawn->GetWorld()->GetSubsystem<UShooterFlowFieldManager>();
+
+	FVector FlowPoint;
+	if (FlowFields && FlowFields->GetNextFlowPoint(TargetActor, PawnLocation, SteeringLookahead, FlowPoint))
+	{
+		if (MyMemory->bPathFallback)
+		{
+			MyController->StopMovement();
+			MyMemory->bPathFallback = false;
+		}
+
+		MyPawn->AddMovementInput((FlowPoint - PawnLocation).GetSafeNormal2D());
+	}
+	else if (!MyMemory->bPathFallback)
+	{
+		/* Field is still being computed or we are off the grid, path to the target on our own meanwhile */
+		MyMemory->bPathFallback = MyController->MoveToActor(TargetActor, AcceptableRadius) != EPathFollowingRequestResult::Failed;
+	}
+}
+
+
+uint16 UBTTask_MoveAlongFlowField::GetInstanceMemorySize() const
+{
+	return sizeof(FBTMoveAlongFlowFieldMemory);
+}
@@ -2,7 +2,34 @@
 
 
 #include "AI/ShooterBotWaypoint.h"
+#include "World/ShooterWaypointRegistry.h"
 
 
+AShooterBotWaypoint::AShooterBotWaypoint()
+{
+	PatrolRadius = 200.0f;
+}
 
 
+void AShooterBotWaypoint::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UShooterWaypointRegistry* WaypointRegistry = GetWorld()->GetSubsystem<UShooterWaypointRegistry>();
+	if (WaypointRegistry)
+	{
+		WaypointRegistry->RegisterWaypoint(this);
+	}
+}
+
+
+void AShooterBotWaypoint::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UShooterWaypointRegistry* WaypointRegistry = GetWorld()->GetSubsystem<UShooterWaypointRegistry>();
+	if (WaypointRegistry)
+	{
+		WaypointRegistry->UnregisterWaypoint(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
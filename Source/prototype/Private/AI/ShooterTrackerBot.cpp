@@ -4,15 +4,15 @@
 #include "AI/ShooterTrackerBot.h"
 #include "Components/StaticMeshComponent.h"
 #include "Kismet/GameplayStatics.h"
-#include "NavigationSystem.h"
-#include "NavigationPath.h"
 #include "GameFramework/Character.h"
 #include "DrawDebugHelpers.h"
 #include "Components/ShooterHealthComponent.h"
 #include "ShooterCharacter.h"
 #include "Components/SphereComponent.h"
 #include "Sound/SoundCue.h"
-#include "EngineUtils.h"
+#include "World/ShooterPawnRegistry.h"
+#include "World/ShooterPathCache.h"
+#include "World/ShooterFlowFieldManager.h"
 
 
 static int32 DebugTrackerBotDrawing = 0;
@@ -47,6 +47,8 @@ AShooterTrackerBot::AShooterTrackerBot()
 	bUseVelocityChange = false;
 	MovementForce = 1000;
 	RequiredDistanceToTarget = 100;
+	TargetSearchRadius = 5000;
+	bUseFlowField = true;
 
 	ExplosionDamage = 60;
 	ExplosionRadius = 350;
@@ -59,8 +61,15 @@ void AShooterTrackerBot::BeginPlay()
 {
 	Super::BeginPlay();
 
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (PawnRegistry)
+	{
+		PawnRegistry->RegisterPawn(this);
+	}
+
 	if (HasAuthority())
 	{
+		NextPathPoint = GetActorLocation();
 		NextPathPoint = GetNextPathPoint();
 
 		// Every second we update our power-level based on nearby bots (CHALLENGE CODE)
@@ -69,6 +78,17 @@ void AShooterTrackerBot::BeginPlay()
 	}
 }
 
+void AShooterTrackerBot::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (PawnRegistry)
+	{
+		PawnRegistry->UnregisterPawn(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void AShooterTrackerBot::HandleTakeDamage(UShooterHealthComponent* OwningHealthComp, float Health, float HealthDelta, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser)
 {
 	if (MatInst == nullptr)
@@ -90,42 +110,46 @@ void AShooterTrackerBot::HandleTakeDamage(UShooterHealthComponent* OwningHealthC
 
 FVector AShooterTrackerBot::GetNextPathPoint()
 {
-	AActor* BestTarget = nullptr;
-	float NearestTargetDistance = FLT_MAX;
+	APawn* BestTarget = nullptr;
 
-	for (TActorIterator<APawn> It(GetWorld()); It; ++It)
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (PawnRegistry)
 	{
-		APawn* TestPawn = *It;
-		if (TestPawn == nullptr || UShooterHealthComponent::IsFriendly(TestPawn, this))
+		const int32 Team = UShooterPawnRegistry::GetPawnTeam(this);
+		BestTarget = PawnRegistry->FindNearestPawn(GetActorLocation(), TargetSearchRadius, Team, EShooterTeamFilter::OtherTeam);
+		if (BestTarget == nullptr)
 		{
-			continue;
+			BestTarget = PawnRegistry->FindNearestPawn(GetActorLocation(), BIG_NUMBER, Team, EShooterTeamFilter::OtherTeam);
 		}
+	}
 
-		UShooterHealthComponent* TestPawnHealthComp = Cast<UShooterHealthComponent>(TestPawn->GetComponentByClass(UShooterHealthComponent::StaticClass()));
-		if (TestPawnHealthComp && TestPawnHealthComp->GetHealth() > 0.0f)
+	if (BestTarget)
+	{
+		if (bUseFlowField)
 		{
-			float Distance = (TestPawn->GetActorLocation() - GetActorLocation()).Size();
+			UShooterFlowFieldManager* FlowFields = GetWorld()->GetSubsystem<UShooterFlowFieldManager>();
 
-			if (Distance < NearestTargetDistance)
+			FVector FlowPoint;
+			if (FlowFields && FlowFields->GetNextFlowPoint(BestTarget, GetActorLocation(), RequiredDistanceToTarget, FlowPoint))
 			{
-				BestTarget = TestPawn;
-				NearestTargetDistance = Distance;
+				return FlowPoint;
 			}
 		}
-	}
 
-	if (BestTarget)
-	{
-		UNavigationPath* NavPath = UNavigationSystemV1::FindPathToActorSynchronously(this, GetActorLocation(), BestTarget);
-
-		GetWorldTimerManager().ClearTimer(TimerHandle_RefreshPath);
-		GetWorldTimerManager().SetTimer(TimerHandle_RefreshPath, this, &AShooterTrackerBot::RefreshPath, 5.0f, false);
+		UShooterPathCache* PathCache = GetWorld()->GetSubsystem<UShooterPathCache>();
 
-		if (NavPath && NavPath->PathPoints.Num() > 1)
+		FVector PathPoint;
+		if (PathCache && PathCache->FindNextPathPoint(GetActorLocation(), BestTarget, RequiredDistanceToTarget, PathPoint))
 		{
+			GetWorldTimerManager().ClearTimer(TimerHandle_RefreshPath);
+			GetWorldTimerManager().SetTimer(TimerHandle_RefreshPath, this, &AShooterTrackerBot::RefreshPath, 5.0f, false);
+
 			// Return next point in the path
-			return NavPath->PathPoints[1];
+			return PathPoint;
 		}
+
+		// Path query still running, keep steering towards the previous point
+		return NextPathPoint;
 	}
 
 	// Failed to find path
@@ -141,6 +165,12 @@ void AShooterTrackerBot::SelfDestruct()
 
 	bExploded = true;
 
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (PawnRegistry)
+	{
+		PawnRegistry->UpdatePawn(this);
+	}
+
 	UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ExplosionEffect, GetActorLocation());
 
 	UGameplayStatics::PlaySoundAtLocation(this, ExplodeSound, GetActorLocation());
@@ -180,6 +210,13 @@ void AShooterTrackerBot::Tick(float DeltaTime)
 
 	if (HasAuthority() && !bExploded)
 	{
+		/* Physics driven, so there is no movement component to report our position */
+		UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+		if (PawnRegistry)
+		{
+			PawnRegistry->UpdatePawnLocation(this);
+		}
+
 		float DistanceToTarget = (GetActorLocation() - NextPathPoint).Size();
 
 		if (DistanceToTarget <= RequiredDistanceToTarget)
@@ -199,7 +236,15 @@ void AShooterTrackerBot::Tick(float DeltaTime)
 
 			ForceDirection *= MovementForce;
 
-			MeshComp->AddForce(ForceDirection, NAME_None, bUseVelocityChange);
+			if (GetActorTickInterval() > 0.0f)
+			{
+				/* Ticking at a reduced rate (see UShooterAISignificanceManager), push for all the time since the last tick at once */
+				MeshComp->AddImpulse(ForceDirection * DeltaTime, NAME_None, bUseVelocityChange);
+			}
+			else
+			{
+				MeshComp->AddForce(ForceDirection, NAME_None, bUseVelocityChange);
+			}
 			if (DebugTrackerBotDrawing)
 			{
 				DrawDebugDirectionalArrow(GetWorld(), GetActorLocation(), GetActorLocation() + ForceDirection, 32, FColor::Yellow, false, 0.0f, 0, 1.0f);
@@ -246,35 +291,24 @@ void AShooterTrackerBot::OnCheckNearbyBots()
 	// distance to check for nearby bots
 	const float Radius = 600;
 
-	// Create temporary collision shape for overlaps
-	FCollisionShape CollShape;
-	CollShape.SetSphere(Radius);
-
-	// Only find Pawns (eg. players and AI bots)
-	FCollisionObjectQueryParams QueryParams;
-	// Our tracker bot's mesh component is set to Physics Body in Blueprint (default profile of physics simulated actors)
-	QueryParams.AddObjectTypesToQuery(ECC_PhysicsBody);
-	QueryParams.AddObjectTypesToQuery(ECC_Pawn);
-
-	TArray<FOverlapResult> Overlaps;
-	GetWorld()->OverlapMultiByObjectType(Overlaps, GetActorLocation(), FQuat::Identity, QueryParams, CollShape);
-
 	if (DebugTrackerBotDrawing)
 	{
 		DrawDebugSphere(GetWorld(), GetActorLocation(), Radius, 12, FColor::White, false, 1.0f);
 	}
 
 	int32 NrOfBots = 0;
-	// loop over the results using a "range based for loop"
-	for (FOverlapResult Result : Overlaps)
+
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (PawnRegistry)
 	{
-		// Check if we overlapped with another tracker bot (ignoring players and other bot types)
-		AShooterTrackerBot* Bot = Cast<AShooterTrackerBot>(Result.GetActor());
-		// Ignore this trackerbot instance
-		if (Bot && Bot != this)
+		// Count the other tracker bots near us (ignoring players and other bot types)
+		PawnRegistry->ForEachPawnInRadius(GetActorLocation(), Radius, INDEX_NONE, EShooterTeamFilter::Any, [&](APawn* Pawn, float DistSq)
 		{
-			NrOfBots++;
-		}
+			if (Pawn != this && Pawn->IsA<AShooterTrackerBot>())
+			{
+				NrOfBots++;
+			}
+		});
 	}
 
 	const int32 MaxPowerLevel = 4;
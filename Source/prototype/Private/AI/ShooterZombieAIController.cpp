@@ -8,6 +8,7 @@
 #include "BehaviorTree/BehaviorTree.h"
 #include "BehaviorTree/BehaviorTreeComponent.h"
 #include "BehaviorTree/BlackboardComponent.h"
+#include "Perception/AIPerceptionComponent.h"
 
 
 AShooterZombieAIController::AShooterZombieAIController()
@@ -26,6 +27,20 @@ AShooterZombieAIController::AShooterZombieAIController()
 }
 
 
+void AShooterZombieAIController::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	/* Sight, hearing and damage come from the perception manager and PlayHit, a second perception system per bot
+	   would sense every player again and write the same target key */
+	UAIPerceptionComponent* BlueprintPerception = FindComponentByClass<UAIPerceptionComponent>();
+	if (BlueprintPerception)
+	{
+		BlueprintPerception->DestroyComponent();
+	}
+}
+
+
 void AShooterZombieAIController::OnPossess(class APawn* InPawn)
 {
 	Super::OnPossess(InPawn);
@@ -95,6 +110,19 @@ AShooterBaseCharacter* AShooterZombieAIController::GetTargetEnemy() const
 }
 
 
+void AShooterZombieAIController::ResetBlackboard(EBotBehaviorType NewType)
+{
+	if (BlackboardComp)
+	{
+		BlackboardComp->ClearValue(TargetEnemyKeyName);
+		BlackboardComp->ClearValue(CurrentWaypointKeyName);
+		BlackboardComp->ClearValue(PatrolLocationKeyName);
+	}
+
+	SetBlackboardBotType(NewType);
+}
+
+
 void AShooterZombieAIController::SetBlackboardBotType(EBotBehaviorType NewType)
 {
 	if (BlackboardComp)
@@ -7,8 +7,6 @@
 #include "ShooterBaseCharacter.h"
 #include "AI/ShooterBotWaypoint.h"
 #include "ShooterPlayerState.h"
-/* AI Include */
-#include "Perception/PawnSensingComponent.h"
 #include "GameFramework/Character.h"
 #include "Components/CapsuleComponent.h"
 #include "GameFramework/NavMovementComponent.h"
@@ -28,12 +26,14 @@ AShooterZombieCharacter::AShooterZombieCharacter(const class FObjectInitializer&
 		Because the zombie AIController is a blueprint in content and it's better to avoid content references in code.  */
 	/*AIControllerClass = ASZombieAIController::StaticClass();*/
 
-	/* Our sensing component to detect players by visibility and noise checks. */
-	PawnSensingComp = CreateDefaultSubobject<UPawnSensingComponent>(TEXT("PawnSensingComp"));
-	PawnSensingComp->SetPeripheralVisionAngle(60.0f);
-	PawnSensingComp->SightRadius = 2000;
-	PawnSensingComp->HearingThreshold = 600;
-	PawnSensingComp->LOSHearingThreshold = 1200;
+	/* Detect players by visibility and noise checks, sensed by the perception manager. Ranges match what the
+		ZombieCharacter Blueprint used to set on its pawn sensing component. */
+	SightRadius = 4000;
+	PeripheralVisionAngle = 60.0f;
+	HearingThreshold = 1600;
+	LOSHearingThreshold = 4800;
+	SensingInterval = 0.5f;
+	LastSenseTime = 0.0f;
 
 	/* Ignore this channel or it will absorb the trace impacts instead of the skeletal mesh */
 	GetCapsuleComponent()->SetCollisionResponseToChannel(COLLISION_WEAPON, ECR_Ignore);
@@ -65,13 +65,6 @@ void AShooterZombieCharacter::BeginPlay()
 {
 	Super::BeginPlay();
 
-	/* This is the earliest moment we can bind our delegates to the component */
-	/*if (PawnSensingComp)
-	{
-		PawnSensingComp->OnSeePawn.AddDynamic(this, &AShooterZombieCharacter::OnSeePlayer);
-		PawnSensingComp->OnHearNoise.AddDynamic(this, &AShooterZombieCharacter::OnHearNoise);
-	}*/
-
 	BroadcastUpdateAudioLoop(bSensedTarget);
 
 	/* Assign a basic name to identify the bots in the HUD. */
@@ -216,6 +209,39 @@ void AShooterZombieCharacter::SetBotType(EBotBehaviorType NewType)
 }
 
 
+void AShooterZombieCharacter::ResetFromPool(const FTransform& SpawnTransform)
+{
+	bSensedTarget = false;
+	bIsPunching = false;
+	LastSeenTime = 0.0f;
+	LastHeardTime = 0.0f;
+	LastMeleeAttackTime = 0.0f;
+	LastSenseTime = 0.0f;
+
+	AShooterZombieAIController* AIController = Cast<AShooterZombieAIController>(GetController());
+	if (AIController)
+	{
+		AIController->ResetBlackboard(BotType);
+	}
+
+	Super::ResetFromPool(SpawnTransform);
+
+	BroadcastUpdateAudioLoop(false);
+}
+
+
+void AShooterZombieCharacter::ApplyParkedState()
+{
+	/* Parked bots are not alive, the perception manager skips them */
+	Super::ApplyParkedState();
+
+	if (AudioLoopComp)
+	{
+		AudioLoopComp->Stop();
+	}
+}
+
+
 UAudioComponent* AShooterZombieCharacter::PlayCharacterSound(USoundCue* CueToPlay)
 {
 	if (CueToPlay)
@@ -231,6 +257,12 @@ void AShooterZombieCharacter::PlayHit(float DamageTaken, struct FDamageEvent con
 {
 	Super::PlayHit(DamageTaken, DamageEvent, PawnInstigator, DamageCauser, bKilled);
 
+	/* Being shot reveals the shooter, this was the damage sense of the controller's perception component */
+	if (HasAuthority() && !bKilled && PawnInstigator && PawnInstigator->IsPlayerControlled())
+	{
+		OnSeePlayer(PawnInstigator);
+	}
+
 	/* Stop playing the hunting sound */
 	if (AudioLoopComp && bKilled)
 	{
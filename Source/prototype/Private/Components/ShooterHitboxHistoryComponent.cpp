@@ -0,0 +1,308 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/ShooterHitboxHistoryComponent.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerState.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "prototype/prototype.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Rewind Hit"), STAT_ShooterRewindHit, STATGROUP_ShooterNet);
+DECLARE_CYCLE_STAT(TEXT("Record Hitboxes"), STAT_ShooterRecordHitboxes, STATGROUP_ShooterNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rewind Queries"), STAT_ShooterRewindQueries, STATGROUP_ShooterNet);
+
+/* Upper bound for stack buffers, keep in sync with the hitbox setup */
+static const int32 MaxHitboxes = 32;
+
+
+UShooterHitboxHistoryComponent::UShooterHitboxHistoryComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	/* Record the final pose of the frame */
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+
+	MaxRewindTime = 0.5f;
+	SnapshotInterval = 1.0f / 60.0f;
+
+	/* Default mannequin skeleton */
+	Hitboxes.Add(FShooterHitboxDef(TEXT("head"), 16.0f));
+	Hitboxes.Add(FShooterHitboxDef(TEXT("neck_01"), 10.0f));
+	Hitboxes.Add(FShooterHitboxDef(TEXT("spine_03"), 22.0f));
+	Hitboxes.Add(FShooterHitboxDef(TEXT("spine_01"), 20.0f));
+	Hitboxes.Add(FShooterHitboxDef(TEXT("pelvis"), 20.0f));
+	Hitboxes.Add(FShooterHitboxDef(TEXT("upperarm_l"), 9.0f));
+	Hitboxes.Add(FShooterHitboxDef(TEXT("upperarm_r"), 9.0f));
+	Hitboxes.Add(FShooterHitboxDef(TEXT("lowerarm_l"), 8.0f));
+	Hitboxes.Add(FShooterHitboxDef(TEXT("lowerarm_r"), 8.0f));
+	Hitboxes.Add(FShooterHitboxDef(TEXT("thigh_l"), 12.0f));
+	Hitboxes.Add(FShooterHitboxDef(TEXT("thigh_r"), 12.0f));
+	Hitboxes.Add(FShooterHitboxDef(TEXT("calf_l"), 9.0f));
+	Hitboxes.Add(FShooterHitboxDef(TEXT("calf_r"), 9.0f));
+
+	MaxHitboxRadius = 0.0f;
+	Capacity = 0;
+	HeadSlot = INDEX_NONE;
+	NumSnapshots = 0;
+}
+
+
+void UShooterHitboxHistoryComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (Hitboxes.Num() > MaxHitboxes)
+	{
+		UE_LOG(LogGame, Warning, TEXT("%s has %d hitboxes, only the first %d are used for lag compensation."), *GetNameSafe(GetOwner()), Hitboxes.Num(), MaxHitboxes);
+		Hitboxes.SetNum(MaxHitboxes);
+	}
+
+	USkeletalMeshComponent* Mesh = GetOwnerMesh();
+
+	BoneIndices.SetNumUninitialized(Hitboxes.Num());
+	MaxHitboxRadius = 0.0f;
+	for (int32 i = 0; i < Hitboxes.Num(); i++)
+	{
+		BoneIndices[i] = Mesh ? Mesh->GetBoneIndex(Hitboxes[i].BoneName) : INDEX_NONE;
+		MaxHitboxRadius = FMath::Max(MaxHitboxRadius, Hitboxes[i].Radius);
+	}
+
+	/* Only a server with remote players needs history */
+	const bool bRecord = GetOwnerRole() == ROLE_Authority && GetNetMode() != NM_Standalone && Mesh != nullptr;
+	if (bRecord)
+	{
+		Capacity = FMath::Max(2, FMath::CeilToInt(MaxRewindTime / FMath::Max(SnapshotInterval, KINDA_SMALL_NUMBER)) + 2);
+
+		SnapshotTimes.SetNumZeroed(Capacity);
+		SnapshotBounds.SetNumZeroed(Capacity);
+		SnapshotCenters.SetNumZeroed(Capacity * Hitboxes.Num());
+	}
+
+	SetComponentTickEnabled(bRecord);
+}
+
+
+void UShooterHitboxHistoryComponent::ResetHistory()
+{
+	HeadSlot = INDEX_NONE;
+	NumSnapshots = 0;
+
+	/* Until the first snapshot rewinds use the live pose */
+	SetComponentTickEnabled(Capacity > 0);
+}
+
+
+void UShooterHitboxHistoryComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (NumSnapshots > 0 && Now - SnapshotTimes[HeadSlot] < SnapshotInterval)
+	{
+		return;
+	}
+
+	RecordSnapshot(Now);
+}
+
+
+void UShooterHitboxHistoryComponent::RecordSnapshot(float Timestamp)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterRecordHitboxes);
+
+	HeadSlot = (HeadSlot + 1) % Capacity;
+	NumSnapshots = FMath::Min(NumSnapshots + 1, Capacity);
+
+	SnapshotTimes[HeadSlot] = Timestamp;
+	SnapshotBounds[HeadSlot] = SampleCurrent(&SnapshotCenters[HeadSlot * Hitboxes.Num()]);
+}
+
+
+FBox UShooterHitboxHistoryComponent::SampleCurrent(FVector* OutCenters) const
+{
+	FBox Bounds(ForceInit);
+
+	USkeletalMeshComponent* Mesh = GetOwnerMesh();
+	const FVector OwnerLocation = GetOwner()->GetActorLocation();
+
+	for (int32 i = 0; i < Hitboxes.Num(); i++)
+	{
+		const int32 BoneIndex = BoneIndices[i];
+		OutCenters[i] = (Mesh && BoneIndex != INDEX_NONE) ? Mesh->GetBoneTransform(BoneIndex).GetLocation() : OwnerLocation;
+		Bounds += OutCenters[i];
+	}
+
+	return Bounds.ExpandBy(MaxHitboxRadius);
+}
+
+
+int32 UShooterHitboxHistoryComponent::GetSnapshotSlot(int32 Age) const
+{
+	return (HeadSlot - Age + Capacity) % Capacity;
+}
+
+
+FBox UShooterHitboxHistoryComponent::SampleAt(float Timestamp, FVector* OutCenters) const
+{
+	const int32 NumHitboxes = Hitboxes.Num();
+
+	if (NumSnapshots == 0 || Timestamp >= SnapshotTimes[HeadSlot])
+	{
+		return SampleCurrent(OutCenters);
+	}
+
+	/* Walk back from the newest snapshot until we pass the timestamp, the window is small */
+	int32 NewerSlot = HeadSlot;
+	for (int32 Age = 1; Age < NumSnapshots; Age++)
+	{
+		const int32 OlderSlot = GetSnapshotSlot(Age);
+		const float OlderTime = SnapshotTimes[OlderSlot];
+		if (OlderTime <= Timestamp)
+		{
+			const float NewerTime = SnapshotTimes[NewerSlot];
+			const float Alpha = FMath::Clamp((Timestamp - OlderTime) / FMath::Max(NewerTime - OlderTime, KINDA_SMALL_NUMBER), 0.0f, 1.0f);
+
+			const FVector* OlderCenters = &SnapshotCenters[OlderSlot * NumHitboxes];
+			const FVector* NewerCenters = &SnapshotCenters[NewerSlot * NumHitboxes];
+			for (int32 i = 0; i < NumHitboxes; i++)
+			{
+				OutCenters[i] = FMath::Lerp(OlderCenters[i], NewerCenters[i], Alpha);
+			}
+
+			/* Union of both poses contains the interpolated one */
+			return SnapshotBounds[OlderSlot] + SnapshotBounds[NewerSlot];
+		}
+
+		NewerSlot = OlderSlot;
+	}
+
+	/* Older than anything recorded, use the oldest pose */
+	FMemory::Memcpy(OutCenters, &SnapshotCenters[NewerSlot * NumHitboxes], sizeof(FVector) * NumHitboxes);
+	return SnapshotBounds[NewerSlot];
+}
+
+
+bool UShooterHitboxHistoryComponent::RewindLineTrace(float Timestamp, const FVector& TraceStart, const FVector& TraceEnd, float Leeway, FShooterRewindHit& OutHit, float* OutMissDistance) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterRewindHit);
+	INC_DWORD_STAT(STAT_ShooterRewindQueries);
+
+	if (Hitboxes.Num() == 0)
+	{
+		return false;
+	}
+
+	FVector Centers[MaxHitboxes];
+	const FBox Bounds = SampleAt(Timestamp, Centers).ExpandBy(Leeway);
+
+	const FVector TraceDir = TraceEnd - TraceStart;
+	const float TraceLengthSq = TraceDir.SizeSquared();
+	if (!FMath::LineBoxIntersection(Bounds, TraceStart, TraceEnd, TraceDir))
+	{
+		/* Estimate from the bounds instead of testing every hitbox: distance to the box from the point of the segment closest to its center */
+		if (OutMissDistance)
+		{
+			const float T = TraceLengthSq > SMALL_NUMBER ? FMath::Clamp(FVector::DotProduct(Bounds.GetCenter() - TraceStart, TraceDir) / TraceLengthSq, 0.0f, 1.0f) : 0.0f;
+			*OutMissDistance = FMath::Sqrt(Bounds.ComputeSquaredDistanceToPoint(TraceStart + TraceDir * T));
+		}
+
+		return false;
+	}
+
+	float BestTime = MAX_FLT;
+	float MinDistSq = MAX_FLT;
+	int32 MinDistIndex = 0;
+
+	for (int32 i = 0; i < Hitboxes.Num(); i++)
+	{
+		/* Closest point on the segment to the sphere center */
+		const FVector ToCenter = Centers[i] - TraceStart;
+		const float T = TraceLengthSq > SMALL_NUMBER ? FMath::Clamp(FVector::DotProduct(ToCenter, TraceDir) / TraceLengthSq, 0.0f, 1.0f) : 0.0f;
+		const float Radius = Hitboxes[i].Radius + Leeway;
+		const float DistSq = (ToCenter - TraceDir * T).SizeSquared();
+
+		if (DistSq < MinDistSq)
+		{
+			MinDistSq = DistSq;
+			MinDistIndex = i;
+		}
+
+		if (DistSq <= Radius * Radius && T < BestTime)
+		{
+			BestTime = T;
+			OutHit.HitboxIndex = i;
+			OutHit.BoneName = Hitboxes[i].BoneName;
+			OutHit.Location = TraceStart + TraceDir * T;
+		}
+	}
+
+	if (OutHit.HitboxIndex == INDEX_NONE && OutMissDistance)
+	{
+		*OutMissDistance = FMath::Max(FMath::Sqrt(MinDistSq) - Hitboxes[MinDistIndex].Radius - Leeway, 0.0f);
+	}
+
+	return OutHit.HitboxIndex != INDEX_NONE;
+}
+
+
+bool UShooterHitboxHistoryComponent::RewindOverlapSphere(float Timestamp, const FVector& Center, float Radius) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterRewindHit);
+	INC_DWORD_STAT(STAT_ShooterRewindQueries);
+
+	if (Hitboxes.Num() == 0)
+	{
+		return false;
+	}
+
+	FVector Centers[MaxHitboxes];
+	const FBox Bounds = SampleAt(Timestamp, Centers);
+
+	if (Bounds.ComputeSquaredDistanceToPoint(Center) > Radius * Radius)
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < Hitboxes.Num(); i++)
+	{
+		const float TestRadius = Hitboxes[i].Radius + Radius;
+		if (FVector::DistSquared(Centers[i], Center) <= TestRadius * TestRadius)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+float UShooterHitboxHistoryComponent::ClampRewindTimestamp(float ClientTimestamp) const
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	return FMath::Clamp(ClientTimestamp, Now - MaxRewindTime, Now);
+}
+
+
+float UShooterHitboxHistoryComponent::GetRewindTimestampFor(const AController* Controller) const
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	/* Bots and the listen server host see the current state */
+	if (Controller == nullptr || Controller->IsLocalController() || Controller->PlayerState == nullptr)
+	{
+		return Now;
+	}
+
+	/* ExactPing is the round trip in ms: the client saw the world half a trip late and its request took the other half */
+	const float RoundTrip = Controller->PlayerState->ExactPing * 0.001f;
+	return ClampRewindTimestamp(Now - RoundTrip);
+}
+
+
+USkeletalMeshComponent* UShooterHitboxHistoryComponent::GetOwnerMesh() const
+{
+	ACharacter* OwnerCharacter = Cast<ACharacter>(GetOwner());
+	return OwnerCharacter ? OwnerCharacter->GetMesh() : nullptr;
+}
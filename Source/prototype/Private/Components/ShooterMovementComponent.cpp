@@ -3,6 +3,7 @@
 
 #include "Components/ShooterMovementComponent.h"
 #include "ShooterCharacter.h"
+#include "World/ShooterPawnRegistry.h"
 
 float UShooterMovementComponent::GetMaxSpeed() const
 {
@@ -23,4 +24,18 @@ float UShooterMovementComponent::GetMaxSpeed() const
 	}
 
 	return MaxSpeed;
-}
\ No newline at end of file
+}
+
+void UShooterMovementComponent::OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity)
+{
+	Super::OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
+
+	if (PawnOwner && UpdatedComponent && UpdatedComponent->GetComponentLocation() != OldLocation)
+	{
+		UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+		if (PawnRegistry)
+		{
+			PawnRegistry->UpdatePawnLocation(PawnOwner);
+		}
+	}
+}
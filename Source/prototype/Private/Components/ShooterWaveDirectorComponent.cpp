@@ -0,0 +1,202 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/ShooterWaveDirectorComponent.h"
+#include "World/ShooterGameMode.h"
+#include "EnvironmentQuery/EnvQuery.h"
+#include "EnvironmentQuery/EnvQueryManager.h"
+#include "../prototype.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Wave Director Spawn"), STAT_ShooterWaveSpawn, STATGROUP_Game);
+
+/* Delay before retrying after no spawn location was found */
+static const float SpawnLocationRetryDelay = 1.0f;
+
+
+UShooterWaveDirectorComponent::UShooterWaveDirectorComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	SpawnBudgetMicroseconds = 2000;
+	SpawnInterval = 0.1f;
+	TargetFrameTimeMs = 1000.0f / 30.0f;
+	MinWaveScale = 0.25f;
+
+	NumPendingSpawns = 0;
+	QueryId = INDEX_NONE;
+	LastSpawnTime = -BIG_NUMBER;
+	NextLocationRequestTime = 0.0f;
+	NumFailedLocationRequests = 0;
+	AverageFrameTimeMs = 0.0f;
+}
+
+
+void UShooterWaveDirectorComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	/* Work done on the game thread last frame, without the time spent waiting for the frame rate cap */
+	const float FrameTimeMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	AverageFrameTimeMs = AverageFrameTimeMs > 0.0f ? FMath::Lerp(AverageFrameTimeMs, FrameTimeMs, 0.05f) : FrameTimeMs;
+
+	if (NumPendingSpawns <= 0)
+	{
+		return;
+	}
+
+	if (SpawnTransforms.Num() < NumPendingSpawns && QueryId == INDEX_NONE && GetWorld()->GetTimeSeconds() >= NextLocationRequestTime)
+	{
+		RequestSpawnLocations();
+	}
+
+	if (SpawnTransforms.Num() > 0 && GetWorld()->GetTimeSeconds() - LastSpawnTime >= SpawnInterval)
+	{
+		SpawnBots();
+	}
+}
+
+
+int32 UShooterWaveDirectorComponent::StartWave(int32 RequestedBots)
+{
+	/* Shrink the wave while the server can't keep up, AverageFrameTimeMs keeps updating between waves */
+	float WaveScale = 1.0f;
+	if (AverageFrameTimeMs > TargetFrameTimeMs)
+	{
+		WaveScale = FMath::Max(TargetFrameTimeMs / AverageFrameTimeMs, MinWaveScale);
+	}
+
+	NumPendingSpawns = RequestedBots > 0 ? FMath::Max(FMath::RoundToInt(RequestedBots * WaveScale), 1) : 0;
+
+	if (NumPendingSpawns < RequestedBots)
+	{
+		UE_LOG(LogGame, Log, TEXT("Wave scaled down to %d of %d bots (frame time %.1f ms, target %.1f ms)"),
+			NumPendingSpawns, RequestedBots, AverageFrameTimeMs, TargetFrameTimeMs);
+	}
+
+	SetComponentTickEnabled(true);
+
+	return NumPendingSpawns;
+}
+
+
+void UShooterWaveDirectorComponent::StopWave()
+{
+	NumPendingSpawns = 0;
+	SpawnTransforms.Reset();
+	NextLocationRequestTime = 0.0f;
+	NumFailedLocationRequests = 0;
+
+	if (QueryId != INDEX_NONE)
+	{
+		UEnvQueryManager* QueryManager = UEnvQueryManager::GetCurrent(this);
+		if (QueryManager)
+		{
+			QueryManager->AbortQuery(QueryId);
+		}
+		QueryId = INDEX_NONE;
+	}
+
+	/* Keep ticking to measure the frame time for the next wave */
+}
+
+
+void UShooterWaveDirectorComponent::RequestSpawnLocations()
+{
+	AShooterGameMode* GameMode = GetGameMode();
+	if (GameMode == nullptr)
+	{
+		return;
+	}
+
+	if (SpawnLocationQuery)
+	{
+		FEnvQueryRequest QueryRequest(SpawnLocationQuery, GameMode);
+		QueryId = QueryRequest.Execute(EEnvQueryRunMode::AllMatching, FQueryFinishedSignature::CreateUObject(this, &UShooterWaveDirectorComponent::OnSpawnQueryFinished));
+		return;
+	}
+
+	/* No native query, the Blueprint fallback runs synchronously so only ask for one location per frame */
+	FTransform SpawnTransform;
+	if (GameMode->FindBotSpawnTransform(SpawnTransform))
+	{
+		SpawnTransforms.Add(SpawnTransform);
+		NumFailedLocationRequests = 0;
+	}
+	else
+	{
+		OnSpawnLocationsFailed(TEXT("Failed to find bot spawn transform for the wave director."));
+	}
+}
+
+
+void UShooterWaveDirectorComponent::OnSpawnQueryFinished(TSharedPtr<FEnvQueryResult> Result)
+{
+	QueryId = INDEX_NONE;
+
+	if (!Result.IsValid() || !Result->IsSuccsessful() || Result->Items.Num() == 0)
+	{
+		OnSpawnLocationsFailed(TEXT("Spawn location query found no locations."));
+		return;
+	}
+
+	NumFailedLocationRequests = 0;
+
+	/* Items are sorted by score, pick random locations from the best quarter for the bots still missing one */
+	const int32 NumCandidates = FMath::Max(Result->Items.Num() / 4, 1);
+	const int32 NumWanted = NumPendingSpawns - SpawnTransforms.Num();
+
+	for (int32 i = 0; i < NumWanted; i++)
+	{
+		const FVector Location = Result->GetItemAsLocation(FMath::RandHelper(NumCandidates));
+		SpawnTransforms.Add(FTransform(FRotator(0.0f, FMath::FRandRange(-180.0f, 180.0f), 0.0f), Location));
+	}
+}
+
+
+void UShooterWaveDirectorComponent::SpawnBots()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterWaveSpawn);
+
+	AShooterGameMode* GameMode = GetGameMode();
+	if (GameMode == nullptr)
+	{
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = SpawnBudgetMicroseconds / 1000000.0;
+
+	do
+	{
+		GameMode->SpawnBotAt(SpawnTransforms.Pop(false));
+		NumPendingSpawns--;
+	}
+	while (NumPendingSpawns > 0 && SpawnTransforms.Num() > 0 && FPlatformTime::Seconds() - StartTime < Budget);
+
+	LastSpawnTime = GetWorld()->GetTimeSeconds();
+
+	if (NumPendingSpawns <= 0)
+	{
+		StopWave();
+		OnWaveSpawningFinished.ExecuteIfBound();
+	}
+}
+
+
+void UShooterWaveDirectorComponent::OnSpawnLocationsFailed(const TCHAR* Reason)
+{
+	NextLocationRequestTime = GetWorld()->GetTimeSeconds() + SpawnLocationRetryDelay;
+
+	if (NumFailedLocationRequests++ == 0)
+	{
+		UE_LOG(LogGame, Warning, TEXT("%s Retrying every %.1f seconds."), Reason, SpawnLocationRetryDelay);
+	}
+}
+
+
+AShooterGameMode* UShooterWaveDirectorComponent::GetGameMode() const
+{
+	return Cast<AShooterGameMode>(GetOwner());
+}
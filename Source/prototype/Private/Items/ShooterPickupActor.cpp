@@ -22,6 +22,8 @@ AShooterPickupActor::AShooterPickupActor()
 	RespawnDelayRange = 5.0f;
 
 	SetReplicates(true);
+	/* Only changes when picked up or respawned, flushed explicitly */
+	NetDormancy = DORM_Initial;
 }
 
 
@@ -29,9 +31,19 @@ void AShooterPickupActor::BeginPlay()
 {
 	Super::BeginPlay();
 
+	/* Initial dormancy only applies to actors placed in the level, dropped pickups go dormant after their first update.
+	   Pickups that replicate movement stay awake until their physics body goes to sleep */
+	if (HasAuthority() && !IsNetStartupActor() && !IsReplicatingMovement())
+	{
+		SetNetDormancy(DORM_DormantAll);
+	}
+
+	/* Not RespawnPickup, flushing here would replicate every level placed pickup once and undo the initial dormancy.
+	   Clients run this as well so their copy of a dormant pickup starts in the same state */
 	//if (bStartActive)
 	{
-		RespawnPickup();
+		bIsActive = true;
+		OnRespawned();
 	}
 }
 
@@ -42,6 +54,7 @@ void AShooterPickupActor::OnUsed(APawn* InstigatorPawn)
 
 	UGameplayStatics::PlaySoundAtLocation(this, PickupSound, GetActorLocation());
 
+	FlushNetDormancy();
 	bIsActive = false;
 	OnPickedUp();
 
@@ -71,6 +84,7 @@ void AShooterPickupActor::OnPickedUp()
 
 void AShooterPickupActor::RespawnPickup()
 {
+	FlushNetDormancy();
 	bIsActive = true;
 	OnRespawned();
 }
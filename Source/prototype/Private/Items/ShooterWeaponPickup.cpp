@@ -5,6 +5,7 @@
 #include "ShooterCharacter.h"
 #include "ShooterWeapon.h"
 #include "ShooterPlayerController.h"
+#include "Components/StaticMeshComponent.h"
 
 
 AShooterWeaponPickup::AShooterWeaponPickup()
@@ -13,6 +14,30 @@ AShooterWeaponPickup::AShooterWeaponPickup()
 
 	/* Enabled to support simulated physics movement when weapons are dropped by a player */
 	SetReplicateMovement(true);
+
+	/* Wake and sleep events drive the net dormancy */
+	MeshComp->BodyInstance.bGenerateWakeEvents = true;
+	MeshComp->OnComponentWake.AddDynamic(this, &AShooterWeaponPickup::OnMeshWake);
+	MeshComp->OnComponentSleep.AddDynamic(this, &AShooterWeaponPickup::OnMeshSleep);
+}
+
+
+void AShooterWeaponPickup::OnMeshWake(UPrimitiveComponent* WakingComponent, FName BoneName)
+{
+	if (HasAuthority())
+	{
+		SetNetDormancy(DORM_Awake);
+	}
+}
+
+
+void AShooterWeaponPickup::OnMeshSleep(UPrimitiveComponent* SleepingComponent, FName BoneName)
+{
+	if (HasAuthority())
+	{
+		/* The channel sends the resting transform before it closes */
+		SetNetDormancy(DORM_DormantAll);
+	}
 }
 
 
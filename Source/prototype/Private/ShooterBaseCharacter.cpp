@@ -8,18 +8,23 @@
 #include "Components/CapsuleComponent.h"
 #include "Components/ShooterHealthComponent.h"
 #include "Components/ShooterMovementComponent.h"
+#include "Components/ShooterHitboxHistoryComponent.h"
 #include "Components/PawnNoiseEmitterComponent.h"
 #include "Net/UnrealNetwork.h"
-#include "ShooterDamageType.h"
+#include "World/ShooterDamageProfileSubsystem.h"
 #include "GameFramework/PlayerState.h"
 #include "ShooterPlayerState.h"
 #include "Kismet/GameplayStatics.h"
 #include "Sound/SoundCue.h"
 #include "World/ShooterGameMode.h"
 #include "World/ShooterGameState.h"
+#include "World/ShooterPawnRegistry.h"
 #include "ShooterPowerupActor.h"
 #include "Items/ShooterWeaponPickup.h"
 #include "AI/ShooterVIPCharacter.h"
+#include "AIController.h"
+#include "BrainComponent.h"
+#include "TimerManager.h"
 
 
 // Sets default values
@@ -30,6 +35,8 @@ AShooterBaseCharacter::AShooterBaseCharacter(const class FObjectInitializer& Obj
 {
 	NoiseEmitterComp = CreateDefaultSubobject<UPawnNoiseEmitterComponent>(TEXT("NoiseEmitterComp"));
 
+	HitboxHistoryComp = CreateDefaultSubobject<UShooterHitboxHistoryComponent>(TEXT("HitboxHistoryComp"));
+
 	Health = 100;
 
 	TargetingSpeedModifier = 0.5f;
@@ -55,6 +62,11 @@ AShooterBaseCharacter::AShooterBaseCharacter(const class FObjectInitializer& Obj
 
 	PR_PickUpWeapon = 0.4;
 
+	bPooled = false;
+	bInPool = false;
+	PoolGeneration = 0;
+	LastTakeHitGeneration = 0;
+
 	DefaultMaxWalkSpeed = GetCharacterMovement()->MaxWalkSpeed;
 }
 
@@ -180,9 +192,53 @@ void AShooterBaseCharacter::BeginPlay()
 		AShooterGameState* MyGameState = Cast<AShooterGameState>(GetWorld()->GetGameState());
 		if (MyGameState)
 		{
-			MyGameState->VIPHealth = Health;
+			MyGameState->SetVIPHealth(Health);
 		}
 	}
+
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (PawnRegistry)
+	{
+		PawnRegistry->RegisterPawn(this);
+	}
+}
+
+
+void AShooterBaseCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (PawnRegistry)
+	{
+		PawnRegistry->UnregisterPawn(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+void AShooterBaseCharacter::PossessedBy(AController* NewController)
+{
+	Super::PossessedBy(NewController);
+
+	UpdatePawnRegistry();
+}
+
+
+void AShooterBaseCharacter::OnRep_PlayerState()
+{
+	Super::OnRep_PlayerState();
+
+	UpdatePawnRegistry();
+}
+
+
+void AShooterBaseCharacter::UpdatePawnRegistry()
+{
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (PawnRegistry)
+	{
+		PawnRegistry->UpdatePawn(this);
+	}
 }
 
 
@@ -208,7 +264,7 @@ float AShooterBaseCharacter::TakeDamage(float Damage, struct FDamageEvent const&
 			AShooterGameState* MyGameState = Cast<AShooterGameState>(GetWorld()->GetGameState());
 			if (MyGameState)
 			{
-				MyGameState->VIPHealth = Health;
+				MyGameState->SetVIPHealth(Health);
 			}
 		}
 
@@ -216,11 +272,11 @@ float AShooterBaseCharacter::TakeDamage(float Damage, struct FDamageEvent const&
 		{
 			bool bCanDie = true;
 
-			/* Check the damagetype, always allow dying if the cast fails, otherwise check the property if player can die from damagetype */
-			if (DamageEvent.DamageTypeClass)
+			/* Check the damagetype, always allow dying for non shooter damage types, otherwise check if player can die from damagetype */
+			UShooterDamageProfileSubsystem* DamageProfiles = UShooterDamageProfileSubsystem::Get(this);
+			if (DamageProfiles)
 			{
-				UShooterDamageType* DmgType = Cast<UShooterDamageType>(DamageEvent.DamageTypeClass->GetDefaultObject());
-				bCanDie = (DmgType == nullptr || (DmgType && DmgType->GetCanDieFrom()));
+				bCanDie = DamageProfiles->CanDieFrom(DamageProfiles->GetProfileIndex(DamageEvent.DamageTypeClass));
 			}
 
 			if (bCanDie)
@@ -290,6 +346,9 @@ bool AShooterBaseCharacter::Die(float KillingDamage, FDamageEvent const& DamageE
 
 	Health = FMath::Min(0.0f, Health);
 
+	/* Before notifying the game mode, wave and match checks count living pawns */
+	UpdatePawnRegistry();
+
 	/* Fallback to default DamageType if none is specified */
 	UDamageType const* const DamageType = DamageEvent.DamageTypeClass
 		                                      ? DamageEvent.DamageTypeClass->GetDefaultObject<UDamageType>()
@@ -373,13 +432,35 @@ void AShooterBaseCharacter::OnDeath(float KillingDamage, FDamageEvent const& Dam
 		return;
 	}
 
-	SetReplicateMovement(true);
-	TearOff();
+	/* Pooled bots stay on the channel so the pool can reset them on clients later */
+	if (!bPooled)
+	{
+		SetReplicateMovement(true);
+		TearOff();
+	}
 	bDied = true;
 
+	UpdatePawnRegistry();
+
 	PlayHit(KillingDamage, DamageEvent, PawnInstigator, DamageCauser, true);
 
-	DetachFromControllerPendingDestroy();
+	if (bPooled)
+	{
+		/* Keep the controller (and its playerstate and blackboard) for the next life */
+		AAIController* AIController = Cast<AAIController>(Controller);
+		if (AIController)
+		{
+			AIController->StopMovement();
+			if (AIController->GetBrainComponent())
+			{
+				AIController->GetBrainComponent()->StopLogic(TEXT("Died"));
+			}
+		}
+	}
+	else
+	{
+		DetachFromControllerPendingDestroy();
+	}
 
 	/* Disable all collision on capsule */
 	UCapsuleComponent* CapsuleComp = GetCapsuleComponent();
@@ -448,16 +529,187 @@ void AShooterBaseCharacter::SetRagdollPhysics()
 		CharacterComp->SetComponentTickEnabled(false);
 	}
 
+	const float CorpseLifeSpan = bInRagdoll ? 10.0f : 1.0f;
 	if (!bInRagdoll)
 	{
-		// Immediately hide the pawn
-		TurnOff();
+		// Immediately hide the pawn, TurnOff would stop replication which pooled bots still need
+		if (bPooled)
+		{
+			SetActorEnableCollision(false);
+		}
+		else
+		{
+			TurnOff();
+		}
 		SetActorHiddenInGame(true);
-		SetLifeSpan(1.0f);
+	}
+
+	if (!bPooled)
+	{
+		SetLifeSpan(CorpseLifeSpan);
+	}
+	else if (HasAuthority())
+	{
+		GetWorldTimerManager().SetTimer(TimerHandle_ReturnToPool, this, &AShooterBaseCharacter::ReturnToPool, CorpseLifeSpan, false);
+	}
+}
+
+
+void AShooterBaseCharacter::SetPooled(bool bNewPooled)
+{
+	bPooled = bNewPooled;
+}
+
+
+void AShooterBaseCharacter::ReturnToPool()
+{
+	AShooterGameMode* MyGameMode = Cast<AShooterGameMode>(GetWorld()->GetAuthGameMode());
+	if (MyGameMode)
+	{
+		MyGameMode->ReturnBotToPool(this);
+	}
+	else
+	{
+		Destroy();
+	}
+}
+
+
+void AShooterBaseCharacter::ParkInPool()
+{
+	GetWorldTimerManager().ClearTimer(TimerHandle_ReturnToPool);
+
+	AAIController* AIController = Cast<AAIController>(Controller);
+	if (AIController && AIController->GetBrainComponent())
+	{
+		AIController->GetBrainComponent()->StopLogic(TEXT("Parked"));
+	}
+
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (PawnRegistry)
+	{
+		PawnRegistry->UnregisterPawn(this);
+	}
+
+	bInPool = true;
+	PoolGeneration++;
+
+	ApplyParkedState();
+}
+
+
+void AShooterBaseCharacter::ResetFromPool(const FTransform& SpawnTransform)
+{
+	Health = GetMaxHealth();
+	ApplyDamageFactor = 1.0f;
+	SuperSpeedFactor = 1.0f;
+	bWantsToRun = false;
+	bIsTargeting = false;
+
+	bInPool = false;
+	PoolGeneration++;
+
+	ApplyPooledReset();
+	SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+	SetReplicateMovement(true);
+
+	/* Poses from before parking would be interpolated towards the spawn point */
+	HitboxHistoryComp->ResetHistory();
+
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (PawnRegistry)
+	{
+		PawnRegistry->RegisterPawn(this);
+	}
+
+	/* The controller survived our death, restart its logic or spawn one if it got lost */
+	AAIController* AIController = Cast<AAIController>(Controller);
+	if (AIController == nullptr)
+	{
+		SpawnDefaultController();
+	}
+	else if (AIController->GetBrainComponent())
+	{
+		AIController->GetBrainComponent()->RestartLogic();
+	}
+}
+
+
+void AShooterBaseCharacter::ApplyParkedState()
+{
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetActorTickEnabled(false);
+
+	USkeletalMeshComponent* Mesh3P = GetMesh();
+	if (Mesh3P)
+	{
+		Mesh3P->SetAllBodiesSimulatePhysics(false);
+		Mesh3P->SetSimulatePhysics(false);
+	}
+
+	UCharacterMovementComponent* CharacterComp = GetCharacterMovement();
+	if (CharacterComp)
+	{
+		CharacterComp->StopMovementImmediately();
+		CharacterComp->DisableMovement();
+		CharacterComp->SetComponentTickEnabled(false);
+	}
+
+	HitboxHistoryComp->SetComponentTickEnabled(false);
+}
+
+
+void AShooterBaseCharacter::ApplyPooledReset()
+{
+	bDied = false;
+
+	const AShooterBaseCharacter* DefaultCharacter = GetClass()->GetDefaultObject<AShooterBaseCharacter>();
+
+	/* Undo the collision changes of OnDeath */
+	UCapsuleComponent* CapsuleComp = GetCapsuleComponent();
+	const UCapsuleComponent* DefaultCapsule = DefaultCharacter->GetCapsuleComponent();
+	CapsuleComp->SetCollisionProfileName(DefaultCapsule->GetCollisionProfileName());
+	CapsuleComp->SetCollisionEnabled(DefaultCapsule->GetCollisionEnabled());
+	CapsuleComp->SetCollisionResponseToChannels(DefaultCapsule->GetCollisionResponseToChannels());
+
+	/* Get out of ragdoll and back onto the capsule */
+	USkeletalMeshComponent* Mesh3P = GetMesh();
+	const USkeletalMeshComponent* DefaultMesh = DefaultCharacter->GetMesh();
+	if (Mesh3P && DefaultMesh)
+	{
+		Mesh3P->SetAllBodiesSimulatePhysics(false);
+		Mesh3P->SetSimulatePhysics(false);
+		Mesh3P->bBlendPhysics = false;
+		Mesh3P->SetCollisionProfileName(DefaultMesh->GetCollisionProfileName());
+		Mesh3P->SetCollisionResponseToChannels(DefaultMesh->GetCollisionResponseToChannels());
+		Mesh3P->AttachToComponent(CapsuleComp, FAttachmentTransformRules::KeepRelativeTransform);
+		Mesh3P->SetRelativeLocationAndRotation(DefaultMesh->GetRelativeLocation(), DefaultMesh->GetRelativeRotation());
+	}
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	SetActorTickEnabled(true);
+
+	UCharacterMovementComponent* CharacterComp = GetCharacterMovement();
+	if (CharacterComp)
+	{
+		CharacterComp->SetComponentTickEnabled(true);
+		CharacterComp->SetDefaultMovementMode();
+		CharacterComp->MaxWalkSpeed = DefaultMaxWalkSpeed;
+	}
+}
+
+
+void AShooterBaseCharacter::OnRep_PoolGeneration()
+{
+	if (bInPool)
+	{
+		ApplyParkedState();
 	}
 	else
 	{
-		SetLifeSpan(10.0f);
+		ApplyPooledReset();
 	}
 }
 
@@ -493,7 +745,7 @@ void AShooterBaseCharacter::ReplicateHit(float DamageTaken, struct FDamageEvent
 
 	FDamageEvent const& LastDamageEvent = LastTakeHitInfo.GetDamageEvent();
 	if (PawnInstigator == LastTakeHitInfo.PawnInstigator.Get() && LastDamageEvent.DamageTypeClass == LastTakeHitInfo.
-		DamageTypeClass)
+		DamageTypeClass && LastTakeHitGeneration == PoolGeneration)
 	{
 		// Same frame damage
 		if (bKilled && LastTakeHitInfo.bKilled)
@@ -511,6 +763,7 @@ void AShooterBaseCharacter::ReplicateHit(float DamageTaken, struct FDamageEvent
 	LastTakeHitInfo.SetDamageEvent(DamageEvent);
 	LastTakeHitInfo.bKilled = bKilled;
 	LastTakeHitInfo.EnsureReplication();
+	LastTakeHitGeneration = PoolGeneration;
 }
 
 
@@ -631,4 +884,7 @@ void AShooterBaseCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>
 	DOREPLIFETIME(AShooterBaseCharacter, LastTakeHitInfo);
 	DOREPLIFETIME(AShooterBaseCharacter, ApplyDamageFactor);
 	DOREPLIFETIME(AShooterBaseCharacter, SuperSpeedFactor);
+	DOREPLIFETIME(AShooterBaseCharacter, bPooled);
+	DOREPLIFETIME(AShooterBaseCharacter, bInPool);
+	DOREPLIFETIME(AShooterBaseCharacter, PoolGeneration);
 }
@@ -13,6 +13,7 @@
 #include "Items/ShooterWeaponPickup.h"
 #include "Sound/SoundCue.h"
 #include "ShooterPlayerState.h"
+#include "Components/ShooterHitboxHistoryComponent.h"
 
 // Sets default values
 AShooterCharacter::AShooterCharacter(const class FObjectInitializer& ObjectInitializer)
@@ -49,6 +50,7 @@ AShooterCharacter::AShooterCharacter(const class FObjectInitializer& ObjectIniti
 	SprintingSpeedModifier = 2.5f;
 
 	bPendingPunch = false;
+	PunchReach = 150.0f;
 
 	ShootSpeedFactor = 1.0f;
 }
@@ -75,7 +77,7 @@ void AShooterCharacter::MakePawnNoise(float Loudness)
 {
 	if (HasAuthority())
 	{
-		/* Make noise to be picked up by PawnSensingComponent by the enemy pawns */
+		/* Make noise to be picked up by the perception manager for the enemy pawns */
 		MakeNoise(Loudness, this, GetActorLocation());
 	}
 	LastNoiseLoudness = Loudness;
@@ -352,6 +354,13 @@ void AShooterCharacter::ServerPerformPunchDamage_Implementation(AActor* HitActor
 					return;
 				}
 
+				/* Check the target was in reach at the time the puncher saw it */
+				UShooterHitboxHistoryComponent* HitboxHistory = OtherPawn->FindComponentByClass<UShooterHitboxHistoryComponent>();
+				if (HitboxHistory && !HitboxHistory->RewindOverlapSphere(HitboxHistory->GetRewindTimestampFor(GetController()), GetActorLocation(), PunchReach))
+				{
+					return;
+				}
+
 				FPointDamageEvent DmgEvent;
 				DmgEvent.DamageTypeClass = PunchDamageType;
 				DmgEvent.Damage = PunchDamage;
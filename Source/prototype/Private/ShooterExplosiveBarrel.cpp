@@ -16,6 +16,10 @@ AShooterExplosiveBarrel::AShooterExplosiveBarrel()
 	MeshComp->SetSimulatePhysics(true);
 	// Set to physics body to let radial component affect us (eg. when a nearby barrel explodes)
 	MeshComp->SetCollisionObjectType(ECC_PhysicsBody);
+	// Wake and sleep events drive the net dormancy
+	MeshComp->BodyInstance.bGenerateWakeEvents = true;
+	MeshComp->OnComponentWake.AddDynamic(this, &AShooterExplosiveBarrel::OnMeshWake);
+	MeshComp->OnComponentSleep.AddDynamic(this, &AShooterExplosiveBarrel::OnMeshSleep);
 	RootComponent = MeshComp;
 
 	RadialForceComp = CreateDefaultSubobject<URadialForceComponent>(TEXT("RadialForceComp"));
@@ -29,6 +33,7 @@ AShooterExplosiveBarrel::AShooterExplosiveBarrel()
 
 	SetReplicates(true);
 	SetReplicateMovement(true);
+	NetDormancy = DORM_Initial;
 }
 
 
@@ -40,6 +45,25 @@ void AShooterExplosiveBarrel::OnRep_Exploded()
 	MeshComp->SetMaterial(0, ExplodedMaterial);
 }
 
+void AShooterExplosiveBarrel::OnMeshWake(UPrimitiveComponent* WakingComponent, FName BoneName)
+{
+	if (HasAuthority())
+	{
+		SetNetDormancy(DORM_Awake);
+	}
+}
+
+
+void AShooterExplosiveBarrel::OnMeshSleep(UPrimitiveComponent* SleepingComponent, FName BoneName)
+{
+	if (HasAuthority())
+	{
+		/* The channel sends the resting transform before it closes */
+		SetNetDormancy(DORM_DormantAll);
+	}
+}
+
+
 float AShooterExplosiveBarrel::TakeDamage(float Damage, FDamageEvent const& DamageEvent, AController* EventInstigator,
 	AActor* DamageCauser)
 {
@@ -52,6 +76,7 @@ float AShooterExplosiveBarrel::TakeDamage(float Damage, FDamageEvent const& Dama
 	const float ActualDamage = Super::TakeDamage(Damage, DamageEvent, EventInstigator, DamageCauser);
 	if (ActualDamage > 0.f)
 	{
+		FlushNetDormancy();
 		Health -= ActualDamage;
 
 		if (Health <= 0)
@@ -5,6 +5,7 @@
 #include "World/ShooterGameState.h"
 #include "Engine/Engine.h"
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
 
 
 AShooterPlayerState::AShooterPlayerState()
@@ -20,16 +21,20 @@ void AShooterPlayerState::Reset()
 
 	NumKills = 0;
 	NumDeaths = 0;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AShooterPlayerState, NumKills, this);
+	MARK_PROPERTY_DIRTY_FROM_NAME(AShooterPlayerState, NumDeaths, this);
 }
 
 void AShooterPlayerState::AddKill()
 {
 	NumKills++;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AShooterPlayerState, NumKills, this);
 }
 
 void AShooterPlayerState::AddDeath()
 {
 	NumDeaths++;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AShooterPlayerState, NumDeaths, this);
 }
 
 void AShooterPlayerState::ScorePoints(int32 Points)
@@ -48,6 +53,7 @@ void AShooterPlayerState::ScorePoints(int32 Points)
 void AShooterPlayerState::SetTeamNumber(int32 NewTeamNumber)
 {
 	TeamNumber = NewTeamNumber;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AShooterPlayerState, TeamNumber, this);
 }
 
 
@@ -71,7 +77,11 @@ void AShooterPlayerState::GetLifetimeReplicatedProps(TArray< class FLifetimeProp
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(AShooterPlayerState, NumKills);
-	DOREPLIFETIME(AShooterPlayerState, NumDeaths);
-	DOREPLIFETIME(AShooterPlayerState, TeamNumber);
+	/* Push based, only compared after being marked dirty */
+	FDoRepLifetimeParams SharedParams;
+	SharedParams.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(AShooterPlayerState, NumKills, SharedParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AShooterPlayerState, NumDeaths, SharedParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AShooterPlayerState, TeamNumber, SharedParams);
 }
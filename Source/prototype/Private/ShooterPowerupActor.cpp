@@ -21,6 +21,8 @@ AShooterPowerupActor::AShooterPowerupActor()
 	bIsPowerupActive = false;
 
 	SetReplicates(true);
+	/* Only changes when activated or expired, flushed explicitly */
+	NetDormancy = DORM_DormantAll;
 }
 
 
@@ -35,6 +37,7 @@ void AShooterPowerupActor::OnTickPowerup()
 		
 		OnExpired();
 
+		FlushNetDormancy();
 		bIsPowerupActive = false;
 		OnRep_PowerupActive();
 
@@ -52,6 +55,7 @@ void AShooterPowerupActor::ActivatePowerup(AActor* ActiveFor)
 {
 	OnActivated(ActiveFor);
 
+	FlushNetDormancy();
 	bIsPowerupActive = true;
 	OnRep_PowerupActive();
 
@@ -22,7 +22,8 @@ AShooterPowerupSpawner::AShooterPowerupSpawner()
 	CooldownDuration = 10.0f;
 
 	SetReplicates(true);
-
+	/* Nothing replicated changes after spawn, the powerup instance handles its own state */
+	NetDormancy = DORM_Initial;
 }
 
 // Called when the game starts or when spawned
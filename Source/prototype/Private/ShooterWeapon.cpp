@@ -13,6 +13,9 @@
 #include "Net/UnrealNetwork.h"
 #include "Sound/SoundCue.h"
 #include "ShooterPlayerController.h"
+#include "GameFramework/GameStateBase.h"
+#include "Misc/CoreDelegates.h"
+#include "ProfilingDebugging/CsvProfiler.h"
 
 static int32 DebugWeaponDrawing = 0;
 
@@ -22,6 +25,41 @@ FAutoConsoleVariableRef CVARDebugWeaponDrawing(
 	TEXT("Draw Debug Lines for Weapons"),
 	ECVF_Cheat);
 
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Shot Stream Bytes Per Shot"), STAT_ShotStreamBytesPerShot, STATGROUP_ShooterNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Shot Stream Dropped Shots"), STAT_ShotStreamDropped, STATGROUP_ShooterNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Shot Stream Duplicate Shots"), STAT_ShotStreamDuplicates, STATGROUP_ShooterNet);
+
+/* Upper bounds for the shot stream, also protect the server from malformed packets */
+static const uint32 MaxShotsPerPacket = 8;
+static const uint32 MaxHitsPerShot = 64;
+
+/* Sequences the server can still tell apart, one bit each in the received mask */
+static const int32 ShotSequenceWindow = 64;
+
+CSV_DEFINE_CATEGORY(ShotStream, true);
+
+/* Received shot stream traffic of the current frame over all weapons, flushed to stats and csv at the end of the frame */
+static FThreadSafeCounter FrameShotStreamBits;
+static FThreadSafeCounter FrameShotStreamShots;
+static FDelegateHandle ShotStreamEndFrameHandle;
+
+static void FlushShotStreamStats()
+{
+	const int32 Bits = FrameShotStreamBits.Set(0);
+	const int32 Shots = FrameShotStreamShots.Set(0);
+
+	/* Frames without new shots keep the last value */
+	if (Shots > 0)
+	{
+		const float BytesPerShot = (Bits / 8.0f) / Shots;
+		SET_FLOAT_STAT(STAT_ShotStreamBytesPerShot, BytesPerShot);
+		CSV_CUSTOM_STAT(ShotStream, BytesPerShot, BytesPerShot, ECsvCustomStatOp::Set);
+	}
+}
+
+
+FOnWeaponOwnerChanged AShooterWeapon::NotifyOwnerChanged;
+
 
 // Sets default values
 AShooterWeapon::AShooterWeapon()
@@ -29,6 +67,11 @@ AShooterWeapon::AShooterWeapon()
 	MeshComp = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("MeshComp"));
 	RootComponent = MeshComp;
 
+	/* Only ticks while the fire scheduler is running, after movement and camera updates so shots use this frame's aim */
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+
 	bIsEquipped = false;
 	CurrentState = EWeaponState::Idle;
 
@@ -48,6 +91,18 @@ AShooterWeapon::AShooterWeapon()
 	MaxAmmoPerClip = 30;
 	NoAnimReloadDuration = 1.5f;
 	NoEquipAnimDuration = 0.5f;
+
+	MaxShotsPerFrame = 8;
+	NextShotTime = 0.0f;
+	LastFrameAim = FVector::ForwardVector;
+	bUseScheduledAim = false;
+	ScheduledAim = FVector::ForwardVector;
+	ScheduledTimeOffset = 0.0f;
+
+	ShotRedundancy = 3;
+	ShotResendInterval = 0.1f;
+	bRecordingShot = false;
+	ResetShotStream();
 }
 
 
@@ -79,6 +134,20 @@ void AShooterWeapon::EndPlay(const EEndPlayReason::Type EndPlayReason)
 }
 
 
+void AShooterWeapon::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (!bRefiring)
+	{
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	RunFireScheduler(DeltaSeconds);
+}
+
+
 /*
 	Return Mesh of Weapon
 */
@@ -98,10 +167,17 @@ void AShooterWeapon::SetOwningPawn(AShooterCharacter* NewOwner)
 {
 	if (MyPawn != NewOwner)
 	{
+		AShooterCharacter* OldOwner = MyPawn;
+
 		SetInstigator(NewOwner);
 		MyPawn = NewOwner;
 		// Net owner for RPC calls.
 		SetOwner(NewOwner);
+
+		if (HasAuthority())
+		{
+			NotifyOwnerChanged.Broadcast(this, OldOwner, NewOwner);
+		}
 	}
 }
 
@@ -223,6 +299,9 @@ void AShooterWeapon::OnUnEquip()
 
 void AShooterWeapon::OnEnterInventory(AShooterCharacter* NewOwner)
 {
+	/* Sequences are per owner */
+	ResetShotStream();
+
 	SetOwningPawn(NewOwner);
 	AttachMeshToPawn(StorageSlot);
 }
@@ -330,6 +409,17 @@ bool AShooterWeapon::CanFire() const
 
 
 FVector AShooterWeapon::GetAdjustedAim() const
+{
+	if (bUseScheduledAim)
+	{
+		return ScheduledAim;
+	}
+
+	return GetViewAim();
+}
+
+
+FVector AShooterWeapon::GetViewAim() const
 {
 	APawn* MyInstigator = GetInstigator();
 
@@ -394,6 +484,13 @@ FHitResult AShooterWeapon::WeaponTrace(const FVector& TraceFrom, const FVector&
 
 void AShooterWeapon::HandleFiring()
 {
+	const float ShotTime = GetWorld()->GetTimeSeconds() + ScheduledTimeOffset;
+
+	if (MyPawn && MyPawn->IsLocallyControlled() && !HasAuthority())
+	{
+		BeginShotRecord();
+	}
+
 	if (CurrentAmmoInClip > 0 && CanFire())
 	{
 		if (GetNetMode() != NM_DedicatedServer)
@@ -403,6 +500,8 @@ void AShooterWeapon::HandleFiring()
 
 		if (MyPawn && MyPawn->IsLocallyControlled())
 		{
+			PendingShot.bFired = true;
+
 			FireWeapon();
 
 			UseAmmo();
@@ -439,34 +538,420 @@ void AShooterWeapon::HandleFiring()
 	{
 		if (!HasAuthority())
 		{
-			ServerHandleFiring();
+			CommitShotRecord();
 		}
 
-		/* Retrigger HandleFiring on a delay for automatic weapons */
+		/* Automatic weapons schedule the next shot relative to when this one was due, so frame time doesn't add up */
 		bRefiring = (CurrentState == EWeaponState::Firing && TimeBetweenShots > 0.0f);
 		if (bRefiring)
 		{
-			GetWorldTimerManager().SetTimer(TimerHandle_HandleFiring, this, &AShooterWeapon::HandleFiring, TimeBetweenShots, false);
+			NextShotTime = ShotTime + TimeBetweenShots;
+			SetActorTickEnabled(true);
 		}
 	}
+	else
+	{
+		/* Remote weapons on the server fire from the shot stream, a delayed burst start only plays once */
+		bRefiring = false;
+	}
 
-	/* Make Noise on every shot. The data is managed by the PawnNoiseEmitterComponent created in SBaseCharacter and used by PawnSensingComponent in SZombieCharacter */
+	/* Make Noise on every shot. The data is managed by the PawnNoiseEmitterComponent created in SBaseCharacter and used by the ShooterPerceptionManager for zombies */
 	if (MyPawn)
 	{
 		MyPawn->MakePawnNoise(1.0f);
 	}
 
-	LastFireTime = GetWorld()->GetTimeSeconds();
+	LastFireTime = ShotTime;
+}
+
+
+void AShooterWeapon::RunFireScheduler(float DeltaSeconds)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	const float FrameStartTime = Now - DeltaSeconds;
+	const FVector CurrentAim = GetViewAim();
+
+	const FQuat LastAimQuat = LastFrameAim.ToOrientationQuat();
+	const FQuat CurrentAimQuat = CurrentAim.ToOrientationQuat();
+
+	/*
+	 * Shots are still traced one at a time: ammo, CanFire and reloads are decided per shot in HandleFiring and each
+	 * shot needs its own rewind timestamp on the server. What is batched is the shot stream, flushed once below.
+	 */
+	bBatchingShots = true;
+
+	int32 NumShots = 0;
+	while (bRefiring && NextShotTime <= Now && NumShots < MaxShotsPerFrame)
+	{
+		/* Place the shot between the previous and this frame, both in time and aim */
+		const float Alpha = DeltaSeconds > 0.0f ? FMath::Clamp((NextShotTime - FrameStartTime) / DeltaSeconds, 0.0f, 1.0f) : 1.0f;
+
+		ScheduledAim = FQuat::Slerp(LastAimQuat, CurrentAimQuat, Alpha).GetForwardVector();
+		ScheduledTimeOffset = FMath::Min(NextShotTime - Now, 0.0f);
+		bUseScheduledAim = true;
+
+		HandleFiring();
+
+		NumShots++;
+	}
+
+	bUseScheduledAim = false;
+	ScheduledTimeOffset = 0.0f;
+	bBatchingShots = false;
+
+	/* Don't carry a long hitch over into the next frames */
+	if (bRefiring && NextShotTime <= Now)
+	{
+		NextShotTime = Now;
+	}
+
+	LastFrameAim = CurrentAim;
+
+	FlushShotStream();
+}
+
+
+/************************************************************************/
+/* Shot Stream                                                          */
+/************************************************************************/
+
+bool FShooterShotPacket::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = Map != nullptr;
+	if (!bOutSuccess)
+	{
+		return false;
+	}
+
+	const int64 StartBits = Ar.IsLoading() && Ar.IsNetArchive() ? static_cast<FBitReader&>(Ar).GetPosBits() : 0;
+
+	uint32 NumRecords = FMath::Min<uint32>(Records.Num(), MaxShotsPerPacket);
+	Ar.SerializeInt(NumRecords, MaxShotsPerPacket + 1);
+	if (Ar.IsLoading())
+	{
+		Records.SetNum(NumRecords);
+	}
+
+	/* Values of the previous record as the receiver sees them, so rounding never accumulates */
+	uint16 PrevSequence = 0;
+	float PrevTimestamp = 0.0f;
+	FVector PrevOrigin = FVector::ZeroVector;
+
+	for (uint32 RecordIdx = 0; RecordIdx < NumRecords && bOutSuccess; RecordIdx++)
+	{
+		FShooterShotRecord& Record = Records[RecordIdx];
+
+		if (RecordIdx == 0)
+		{
+			Ar << Record.Sequence;
+			Ar << Record.Timestamp;
+		}
+		else
+		{
+			uint32 SequenceDelta = (uint16)(Record.Sequence - PrevSequence);
+			Ar.SerializeIntPacked(SequenceDelta);
+
+			/* Milliseconds are plenty for rewinding */
+			uint32 TimeDeltaMs = FMath::RoundToInt(FMath::Max(Record.Timestamp - PrevTimestamp, 0.0f) * 1000.0f);
+			Ar.SerializeIntPacked(TimeDeltaMs);
+
+			if (Ar.IsLoading())
+			{
+				Record.Sequence = PrevSequence + SequenceDelta;
+			}
+			Record.Timestamp = PrevTimestamp + TimeDeltaMs * 0.001f;
+		}
+
+		/* Origins are quantized to whole units, consecutive shots barely move so deltas stay small */
+		FVector OriginDelta = Record.Hits.Origin - PrevOrigin;
+		OriginDelta.Set(FMath::RoundToFloat(OriginDelta.X), FMath::RoundToFloat(OriginDelta.Y), FMath::RoundToFloat(OriginDelta.Z));
+		bOutSuccess &= SerializePackedVector<1, 24>(OriginDelta, Ar);
+		const FVector Origin = PrevOrigin + OriginDelta;
+		if (Ar.IsLoading())
+		{
+			Record.Hits.Origin = Origin;
+		}
+
+		uint8 bFired = Record.bFired ? 1 : 0;
+		Ar.SerializeBits(&bFired, 1);
+		Record.bFired = bFired != 0;
+
+		uint32 NumHits = Record.Hits.Hits.Num();
+		Ar.SerializeIntPacked(NumHits);
+		if (NumHits > MaxHitsPerShot)
+		{
+			bOutSuccess = false;
+			break;
+		}
+
+		if (Ar.IsLoading())
+		{
+			Record.Hits.Hits.SetNum(NumHits);
+		}
+
+		for (FShooterPelletHit& Hit : Record.Hits.Hits)
+		{
+			UObject* HitObject = Hit.HitActor;
+			bOutSuccess &= Map->SerializeObject(Ar, AActor::StaticClass(), HitObject);
+			Hit.HitActor = Cast<AActor>(HitObject);
+
+			uint8 bHasBone = Hit.BoneIndex != INDEX_NONE ? 1 : 0;
+			Ar.SerializeBits(&bHasBone, 1);
+			if (bHasBone)
+			{
+				uint32 BoneIndex = Hit.BoneIndex;
+				Ar.SerializeIntPacked(BoneIndex);
+				Hit.BoneIndex = (int16)BoneIndex;
+			}
+			else
+			{
+				Hit.BoneIndex = INDEX_NONE;
+			}
+
+			uint8 bBlockingHit = Hit.bBlockingHit ? 1 : 0;
+			Ar.SerializeBits(&bBlockingHit, 1);
+			Hit.bBlockingHit = bBlockingHit != 0;
+
+			/* Impact relative to the muzzle, bounded by the weapon range */
+			FVector ImpactDelta = Hit.ImpactPoint - Origin;
+			bOutSuccess &= SerializePackedVector<1, 24>(ImpactDelta, Ar);
+			if (Ar.IsLoading())
+			{
+				Hit.ImpactPoint = Origin + ImpactDelta;
+			}
+		}
+
+		PrevSequence = Record.Sequence;
+		PrevTimestamp = Record.Timestamp;
+		PrevOrigin = Origin;
+	}
+
+	if (Ar.IsLoading() && Ar.IsNetArchive())
+	{
+		SerializedBits = static_cast<FBitReader&>(Ar).GetPosBits() - StartBits;
+	}
+
+	return bOutSuccess;
 }
 
 
-bool AShooterWeapon::ServerHandleFiring_Validate()
+float AShooterWeapon::GetServerWorldTime() const
 {
+	AGameStateBase* GameState = GetWorld()->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
+
+
+void AShooterWeapon::ResetShotStream()
+{
+	PendingShot = FShooterShotRecord();
+	UnackedShots.Reset();
+	NextShotSequence = 1;
+	bBatchingShots = false;
+	NumNewShots = 0;
+
+	/* Everything before the first sequence counts as received */
+	LastReceivedShotSequence = 0;
+	ReceivedShotMask = ~0ull;
+	ShotAckSequence = 0;
+}
+
+
+void AShooterWeapon::BeginShotRecord()
+{
+	PendingShot.Sequence = NextShotSequence++;
+	PendingShot.Timestamp = GetServerWorldTime() + ScheduledTimeOffset;
+	PendingShot.bFired = false;
+	PendingShot.Hits.Origin = FVector::ZeroVector;
+	PendingShot.Hits.Hits.Reset();
+
+	bRecordingShot = true;
+}
+
+
+void AShooterWeapon::CommitShotRecord()
+{
+	if (!bRecordingShot)
+	{
+		return;
+	}
+
+	bRecordingShot = false;
+
+	/* Shots older than the server's window can't be told apart anymore, give up on them */
+	if (UnackedShots.Num() >= ShotSequenceWindow)
+	{
+		UnackedShots.RemoveAt(0, 1, false);
+	}
+	UnackedShots.Add(PendingShot);
+	NumNewShots++;
+
+	if (!bBatchingShots)
+	{
+		SendShotPacket(false);
+	}
+
+	if (!GetWorldTimerManager().IsTimerActive(TimerHandle_ResendShots))
+	{
+		GetWorldTimerManager().SetTimer(TimerHandle_ResendShots, this, &AShooterWeapon::ResendUnackedShots, ShotResendInterval, true);
+	}
+}
+
+
+void AShooterWeapon::SendShotPacket(bool bSendOldest)
+{
+	const int32 NumToSend = FMath::Min3(UnackedShots.Num(), ShotRedundancy + FMath::Max(NumNewShots, 1), (int32)MaxShotsPerPacket);
+	NumNewShots = 0;
+
+	if (NumToSend <= 0)
+	{
+		return;
+	}
+
+	/* New shots go out with the shots before them, resends start at the oldest so a backlog drains */
+	const int32 FirstIdx = bSendOldest ? 0 : UnackedShots.Num() - NumToSend;
+
+	FShooterShotPacket Packet;
+	Packet.Records.Append(&UnackedShots[FirstIdx], NumToSend);
+
+	ServerShotStream(Packet);
+}
+
+
+void AShooterWeapon::FlushShotStream()
+{
+	if (NumNewShots > 0)
+	{
+		SendShotPacket(false);
+	}
+}
+
+
+void AShooterWeapon::ResendUnackedShots()
+{
+	if (UnackedShots.Num() == 0)
+	{
+		GetWorldTimerManager().ClearTimer(TimerHandle_ResendShots);
+		return;
+	}
+
+	SendShotPacket(true);
+}
+
+
+void AShooterWeapon::OnRep_ShotAck()
+{
+	int32 NumAcked = 0;
+	while (NumAcked < UnackedShots.Num() && (int16)(UnackedShots[NumAcked].Sequence - ShotAckSequence) <= 0)
+	{
+		NumAcked++;
+	}
+
+	UnackedShots.RemoveAt(0, NumAcked, false);
+}
+
+
+bool AShooterWeapon::ServerShotStream_Validate(const FShooterShotPacket& Packet)
+{
+	return Packet.Records.Num() <= (int32)MaxShotsPerPacket;
+}
+
+
+void AShooterWeapon::ServerShotStream_Implementation(const FShooterShotPacket& Packet)
+{
+	int32 NumAcceptedShots = 0;
+
+	for (const FShooterShotRecord& Record : Packet.Records)
+	{
+		if (AcceptShotSequence(Record.Sequence))
+		{
+			NumAcceptedShots++;
+			ProcessShotRecord(Record);
+		}
+		else
+		{
+			INC_DWORD_STAT(STAT_ShotStreamDuplicates);
+		}
+	}
+
+	UpdateShotAck();
+
+	if (!ShotStreamEndFrameHandle.IsValid())
+	{
+		ShotStreamEndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&FlushShotStreamStats);
+	}
+
+	FrameShotStreamBits.Add(Packet.SerializedBits);
+	FrameShotStreamShots.Add(NumAcceptedShots);
+}
+
+
+bool AShooterWeapon::AcceptShotSequence(uint16 Sequence)
+{
+	const int32 Delta = (int16)(Sequence - LastReceivedShotSequence);
+
+	if (Delta > 0)
+	{
+		/* Sequences leaving the window without their bit set were never received */
+		int32 NumDropped = 0;
+		if (Delta >= ShotSequenceWindow)
+		{
+			NumDropped = ShotSequenceWindow - FPlatformMath::CountBits(ReceivedShotMask) + (Delta - ShotSequenceWindow);
+			ReceivedShotMask = 1;
+		}
+		else
+		{
+			NumDropped = Delta - FPlatformMath::CountBits(ReceivedShotMask >> (ShotSequenceWindow - Delta));
+			ReceivedShotMask = (ReceivedShotMask << Delta) | 1;
+		}
+
+		INC_DWORD_STAT_BY(STAT_ShotStreamDropped, NumDropped);
+
+		LastReceivedShotSequence = Sequence;
+		return true;
+	}
+
+	const int32 Age = -Delta;
+	if (Age >= ShotSequenceWindow)
+	{
+		return false;
+	}
+
+	const uint64 Bit = 1ull << Age;
+	if (ReceivedShotMask & Bit)
+	{
+		return false;
+	}
+
+	/* Late but not seen yet, the packet carrying it first was lost */
+	ReceivedShotMask |= Bit;
 	return true;
 }
 
 
-void AShooterWeapon::ServerHandleFiring_Implementation()
+void AShooterWeapon::UpdateShotAck()
+{
+	/* Only shots still inside the window can hold the ack back */
+	const uint16 OldestInWindow = LastReceivedShotSequence - (ShotSequenceWindow - 1);
+	if ((int16)(ShotAckSequence - OldestInWindow) < 0)
+	{
+		ShotAckSequence = OldestInWindow - 1;
+	}
+
+	while (ShotAckSequence != LastReceivedShotSequence)
+	{
+		const int32 Age = (int16)(LastReceivedShotSequence - (uint16)(ShotAckSequence + 1));
+		if ((ReceivedShotMask & (1ull << Age)) == 0)
+		{
+			break;
+		}
+
+		ShotAckSequence++;
+	}
+}
+
+
+void AShooterWeapon::ProcessShotRecord(const FShooterShotRecord& Record)
 {
 	const bool bShouldUpdateAmmo = (CurrentAmmoInClip > 0 && CanFire());
 
@@ -478,10 +963,21 @@ void AShooterWeapon::ServerHandleFiring_Implementation()
 
 		// Update firing FX on remote clients
 		BurstCounter++;
+
+		/* Hits are only accepted for rounds the server agrees were fired */
+		if (Record.bFired)
+		{
+			ServerProcessShotHits(Record);
+		}
 	}
 }
 
 
+void AShooterWeapon::ServerProcessShotHits(const FShooterShotRecord& Record)
+{
+}
+
+
 void AShooterWeapon::SimulateWeaponFire()
 {
 	if (MuzzleFX)
@@ -578,12 +1074,17 @@ void AShooterWeapon::SetWeaponState(EWeaponState NewState)
 
 void AShooterWeapon::OnBurstStarted()
 {
+	LastFrameAim = GetViewAim();
+
 	// Start firing, can be delayed to satisfy TimeBetweenShots
 	const float GameTime = GetWorld()->GetTimeSeconds();
 	if (LastFireTime > 0 && TimeBetweenShots > 0.0f &&
 		LastFireTime + TimeBetweenShots > GameTime)
 	{
-		GetWorldTimerManager().SetTimer(TimerHandle_HandleFiring, this, &AShooterWeapon::HandleFiring, LastFireTime + TimeBetweenShots - GameTime, false);
+		/* The scheduler fires it once it is due */
+		NextShotTime = LastFireTime + TimeBetweenShots;
+		bRefiring = true;
+		SetActorTickEnabled(true);
 	}
 	else
 	{
@@ -601,8 +1102,8 @@ void AShooterWeapon::OnBurstFinished()
 		StopSimulatingWeaponFire();
 	}
 
-	GetWorldTimerManager().ClearTimer(TimerHandle_HandleFiring);
 	bRefiring = false;
+	SetActorTickEnabled(false);
 }
 
 
@@ -885,6 +1386,7 @@ void AShooterWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLi
 	DOREPLIFETIME_CONDITION(AShooterWeapon, BurstCounter, COND_SkipOwner);
 	DOREPLIFETIME_CONDITION(AShooterWeapon, bPendingReload, COND_SkipOwner);
 	DOREPLIFETIME(AShooterWeapon, TimeBetweenShots);
+	DOREPLIFETIME_CONDITION(AShooterWeapon, ShotAckSequence, COND_OwnerOnly);
 	
 }
 
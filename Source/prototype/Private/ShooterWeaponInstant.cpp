@@ -3,14 +3,107 @@
 
 #include "ShooterWeaponInstant.h"
 #include "ShooterImpactEffect.h"
-#include "ShooterDamageType.h"
+#include "World/ShooterFXManager.h"
+#include "World/ShooterDamageProfileSubsystem.h"
 #include "prototype/prototype.h"
 #include "PhysicalMaterials/PhysicalMaterial.h"
 #include "Net/UnrealNetwork.h"
 #include "Particles/ParticleSystemComponent.h"
-#include "Kismet/GameplayStatics.h"
+#include "Components/SkeletalMeshComponent.h"
 #include "Perception/AISense_Damage.h"
 #include "ShooterPlayerState.h"
+#include "Components/ShooterHitboxHistoryComponent.h"
+#include "World/ShooterAISignificanceManager.h"
+#include "Misc/CoreDelegates.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "EngineUtils.h"
+
+static int32 SyncCosmeticTraces = 0;
+FAutoConsoleVariableRef CVARSyncCosmeticTraces(
+	TEXT("COOP.SyncCosmeticTraces"),
+	SyncCosmeticTraces,
+	TEXT("Trace remote shots for hit FX on the game thread instead of async, for debugging"),
+	ECVF_Cheat);
+
+/* Distance the rewind trace continues past the claimed impact point, impacts lie on the collision surface which
+   can be outside the hitbox spheres */
+static const float RewindTraceOvershoot = 50.0f;
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Accepted"), STAT_HitRegAccepted, STATGROUP_ShooterHitReg);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Static Accepted"), STAT_HitRegStaticAccepted, STATGROUP_ShooterHitReg);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rejected View Dot"), STAT_HitRegRejectedViewDot, STATGROUP_ShooterHitReg);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rejected Bounds"), STAT_HitRegRejectedBounds, STATGROUP_ShooterHitReg);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rejected Origin"), STAT_HitRegRejectedOrigin, STATGROUP_ShooterHitReg);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rejected < 10cm"), STAT_HitRegReject10, STATGROUP_ShooterHitReg);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rejected < 25cm"), STAT_HitRegReject25, STATGROUP_ShooterHitReg);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rejected < 50cm"), STAT_HitRegReject50, STATGROUP_ShooterHitReg);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rejected < 100cm"), STAT_HitRegReject100, STATGROUP_ShooterHitReg);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rejected < 250cm"), STAT_HitRegReject250, STATGROUP_ShooterHitReg);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rejected >= 250cm"), STAT_HitRegRejectFar, STATGROUP_ShooterHitReg);
+
+CSV_DEFINE_CATEGORY(HitReg, true);
+
+/* Totals of the current frame over all weapons, flushed to stats and csv at the end of the frame */
+static FThreadSafeCounter FrameHitRegResults[(int32)EShooterHitRegResult::Num];
+static FThreadSafeCounter FrameHitRegRejectDistances[FShooterHitRegCounters::NumDistanceBuckets];
+static FDelegateHandle HitRegEndFrameHandle;
+
+static void FlushHitRegStats()
+{
+	int32 Results[(int32)EShooterHitRegResult::Num];
+	for (int32 i = 0; i < (int32)EShooterHitRegResult::Num; i++)
+	{
+		Results[i] = FrameHitRegResults[i].Set(0);
+	}
+
+	int32 Distances[FShooterHitRegCounters::NumDistanceBuckets];
+	for (int32 i = 0; i < FShooterHitRegCounters::NumDistanceBuckets; i++)
+	{
+		Distances[i] = FrameHitRegRejectDistances[i].Set(0);
+	}
+
+	INC_DWORD_STAT_BY(STAT_HitRegAccepted, Results[(int32)EShooterHitRegResult::Accepted]);
+	INC_DWORD_STAT_BY(STAT_HitRegStaticAccepted, Results[(int32)EShooterHitRegResult::StaticAccepted]);
+	INC_DWORD_STAT_BY(STAT_HitRegRejectedViewDot, Results[(int32)EShooterHitRegResult::RejectedViewDot]);
+	INC_DWORD_STAT_BY(STAT_HitRegRejectedBounds, Results[(int32)EShooterHitRegResult::RejectedBounds]);
+	INC_DWORD_STAT_BY(STAT_HitRegRejectedOrigin, Results[(int32)EShooterHitRegResult::RejectedOrigin]);
+	INC_DWORD_STAT_BY(STAT_HitRegReject10, Distances[0]);
+	INC_DWORD_STAT_BY(STAT_HitRegReject25, Distances[1]);
+	INC_DWORD_STAT_BY(STAT_HitRegReject50, Distances[2]);
+	INC_DWORD_STAT_BY(STAT_HitRegReject100, Distances[3]);
+	INC_DWORD_STAT_BY(STAT_HitRegReject250, Distances[4]);
+	INC_DWORD_STAT_BY(STAT_HitRegRejectFar, Distances[5]);
+
+	CSV_CUSTOM_STAT(HitReg, Accepted, Results[(int32)EShooterHitRegResult::Accepted], ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(HitReg, StaticAccepted, Results[(int32)EShooterHitRegResult::StaticAccepted], ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(HitReg, RejectedViewDot, Results[(int32)EShooterHitRegResult::RejectedViewDot], ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(HitReg, RejectedBounds, Results[(int32)EShooterHitRegResult::RejectedBounds], ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(HitReg, RejectedOrigin, Results[(int32)EShooterHitRegResult::RejectedOrigin], ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(HitReg, Reject10, Distances[0], ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(HitReg, Reject25, Distances[1], ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(HitReg, Reject50, Distances[2], ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(HitReg, Reject100, Distances[3], ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(HitReg, Reject250, Distances[4], ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(HitReg, RejectFar, Distances[5], ECsvCustomStatOp::Set);
+}
+
+static FAutoConsoleCommandWithWorld DumpHitRegCmd(
+	TEXT("COOP.DumpHitReg"),
+	TEXT("Log the hit registration counters of all instant weapons"),
+	FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+	{
+		for (TActorIterator<AShooterWeaponInstant> It(World); It; ++It)
+		{
+			const FShooterHitRegCounters& Counters = It->GetHitRegCounters();
+			UE_LOG(LogGame, Log, TEXT("%s: accepted %u, static %u, rejected view dot %u, rejected bounds %u, rejected origin %u, reject distances <10 %u <25 %u <50 %u <100 %u <250 %u >=250 %u"),
+				*It->GetName(),
+				Counters.Results[(int32)EShooterHitRegResult::Accepted], Counters.Results[(int32)EShooterHitRegResult::StaticAccepted],
+				Counters.Results[(int32)EShooterHitRegResult::RejectedViewDot], Counters.Results[(int32)EShooterHitRegResult::RejectedBounds],
+				Counters.Results[(int32)EShooterHitRegResult::RejectedOrigin],
+				Counters.RejectDistances[0], Counters.RejectDistances[1], Counters.RejectDistances[2],
+				Counters.RejectDistances[3], Counters.RejectDistances[4], Counters.RejectDistances[5]);
+		}
+	}));
 
 
 AShooterWeaponInstant::AShooterWeaponInstant()
@@ -20,13 +113,50 @@ AShooterWeaponInstant::AShooterWeaponInstant()
 
 	AllowedViewDotHitDir = -1.0f;
 	ClientSideHitLeeway = 200.0f;
+	RewindHitLeeway = 15.0f;
+	MaxShotOriginError = 150.0f;
+
+	PelletCount = 1;
+	PelletSpread = 8.0f;
 	MinimumProjectileSpawnDistance = 800;
 	TracerRoundInterval = 3;
+	TrailPoolSize = 16;
+	MaxTrailDrawDistance = 10000.0f;
+	DamageProfileIndex = UShooterDamageProfileSubsystem::DefaultProfileIndex;
+
+	ReplicatedImpacts.Owner = this;
+
+	CosmeticTraceDelegate.BindUObject(this, &AShooterWeaponInstant::OnCosmeticTraceCompleted);
+}
+
+
+void AShooterWeaponInstant::BeginPlay()
+{
+	Super::BeginPlay();
+
+	/* Create the pooled effects before the first shot instead of during it */
+	UShooterFXManager* FXManager = GetWorld()->GetSubsystem<UShooterFXManager>();
+	if (FXManager)
+	{
+		FXManager->Prewarm();
+	}
+
+	UShooterDamageProfileSubsystem* DamageProfiles = UShooterDamageProfileSubsystem::Get(this);
+	if (DamageProfiles)
+	{
+		DamageProfileIndex = DamageProfiles->GetProfileIndex(DamageType);
+	}
 }
 
 
 void AShooterWeaponInstant::FireWeapon()
 {
+	if (PelletCount > 1)
+	{
+		FirePellets();
+		return;
+	}
+
 	const FVector AimDir = GetAdjustedAim();
 	const FVector CameraPos = GetCameraDamageStartLocation(AimDir);
 	const FVector EndPos = CameraPos + (AimDir * WeaponRange);
@@ -73,24 +203,28 @@ bool AShooterWeaponInstant::ShouldDealDamage(AActor* TestActor) const
 
 
 void AShooterWeaponInstant::DealDamage(const FHitResult& Impact, const FVector& ShootDir)
+{
+	ApplyHitDamage(Impact, ShootDir, GetHitDamage(Impact));
+}
+
+
+float AShooterWeaponInstant::GetHitDamage(const FHitResult& Impact) const
 {
 	float ActualHitDamage = HitDamage * GetPawnOwner()->ApplyDamageFactor;
 
 	/* Handle special damage location on the zombie body (types are setup in the Physics Asset of the zombie */
-	UShooterDamageType* DmgType = Cast<UShooterDamageType>(DamageType->GetDefaultObject());
-	UPhysicalMaterial* PhysMat = Impact.PhysMaterial.Get();
-	if (PhysMat && DmgType)
+	UShooterDamageProfileSubsystem* DamageProfiles = UShooterDamageProfileSubsystem::Get(this);
+	if (DamageProfiles)
 	{
-		if (PhysMat->SurfaceType == SURFACE_ZOMBIEHEAD || PhysMat->SurfaceType == SURFACE_FLESHVULNERABLE)
-		{
-			ActualHitDamage *= DmgType->GetHeadDamageModifier();
-		}
-		else if (PhysMat->SurfaceType == SURFACE_ZOMBIELIMB || PhysMat->SurfaceType == SURFACE_FLESHDEFAULT)
-		{
-			ActualHitDamage *= DmgType->GetLimbDamageModifier();
-		}
+		ActualHitDamage *= DamageProfiles->GetMultiplier(DamageProfileIndex, UPhysicalMaterial::DetermineSurfaceType(Impact.PhysMaterial.Get()));
 	}
 
+	return ActualHitDamage;
+}
+
+
+void AShooterWeaponInstant::ApplyHitDamage(const FHitResult& Impact, const FVector& ShootDir, float Damage)
+{
 	// AI perception Damage Event
 	APawn* DamagedPawn = Cast<APawn>(Impact.GetActor());
 
@@ -101,7 +235,7 @@ void AShooterWeaponInstant::DealDamage(const FHitResult& Impact, const FVector&
 
 		if (DamagedPS && MyPS && DamagedPS->GetTeamNumber() != MyPS->GetTeamNumber())
 		{
-			UAISense_Damage::ReportDamageEvent(GetWorld(), Impact.GetActor(), MyPawn, ActualHitDamage,
+			UAISense_Damage::ReportDamageEvent(GetWorld(), Impact.GetActor(), MyPawn, Damage,
 			                                   MyPawn->GetActorLocation(), Impact.Location);
 		}
 	}
@@ -111,7 +245,7 @@ void AShooterWeaponInstant::DealDamage(const FHitResult& Impact, const FVector&
 	PointDmg.DamageTypeClass = DamageType;
 	PointDmg.HitInfo = Impact;
 	PointDmg.ShotDirection = ShootDir;
-	PointDmg.Damage = ActualHitDamage;
+	PointDmg.Damage = Damage;
 
 	Impact.GetActor()->TakeDamage(PointDmg.Damage, PointDmg, MyPawn->Controller, this);
 }
@@ -119,25 +253,11 @@ void AShooterWeaponInstant::DealDamage(const FHitResult& Impact, const FVector&
 
 void AShooterWeaponInstant::ProcessInstantHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir)
 {
-	if (MyPawn && MyPawn->IsLocallyControlled() && GetNetMode() == NM_Client)
+	/* Owning client reports the hit to the server with the shot */
+	if (bRecordingShot)
 	{
-		// If we are a client and hit something that is controlled by server
-		if (Impact.GetActor() && Impact.GetActor()->GetRemoteRole() == ROLE_Authority)
-		{
-			// Notify the server of our local hit to validate and apply actual hit damage.
-			ServerNotifyHit(Impact, ShootDir);
-		}
-		else if (Impact.GetActor() == nullptr)
-		{
-			if (Impact.bBlockingHit)
-			{
-				ServerNotifyHit(Impact, ShootDir);
-			}
-			else
-			{
-				ServerNotifyMiss(ShootDir);
-			}
-		}
+		PendingShot.Hits.Origin = Origin;
+		PendingShot.Hits.Hits.Add(MakePelletHit(Impact));
 	}
 
 	// Process a confirmed hit.
@@ -157,7 +277,7 @@ void AShooterWeaponInstant::ProcessInstantHitConfirmed(const FHitResult& Impact,
 	// Play FX on remote clients
 	if (HasAuthority())
 	{
-		HitImpactNotify = Impact.ImpactPoint;
+		ReplicatedImpacts.AddImpact(Impact.ImpactPoint);
 	}
 
 	// Play FX locally
@@ -176,8 +296,37 @@ void AShooterWeaponInstant::SimulateInstantHit(const FVector& ImpactPoint)
 	const FVector AimDir = (ImpactPoint - MuzzleOrigin).GetSafeNormal();
 
 	const FVector EndTrace = MuzzleOrigin + (AimDir * WeaponRange);
-	const FHitResult Impact = WeaponTrace(MuzzleOrigin, EndTrace);
 
+	/* Shots of other players only need the trace to place FX, a frame of delay isn't noticeable */
+	AShooterCharacter* OwningPawn = GetPawnOwner();
+	if (SyncCosmeticTraces == 0 && OwningPawn && !OwningPawn->IsLocallyControlled())
+	{
+		FCollisionQueryParams TraceParams(TEXT("WeaponTrace"), true, GetInstigator());
+		TraceParams.bReturnPhysicalMaterial = true;
+
+		GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, MuzzleOrigin, EndTrace, COLLISION_WEAPON, TraceParams, FCollisionResponseParams::DefaultResponseParam, &CosmeticTraceDelegate);
+		return;
+	}
+
+	SpawnHitEffects(WeaponTrace(MuzzleOrigin, EndTrace), EndTrace);
+}
+
+
+void AShooterWeaponInstant::OnCosmeticTraceCompleted(const FTraceHandle& Handle, FTraceDatum& Data)
+{
+	if (Data.OutHits.Num() > 0)
+	{
+		SpawnHitEffects(Data.OutHits[0], Data.End);
+	}
+	else
+	{
+		SpawnTrailEffects(Data.End);
+	}
+}
+
+
+void AShooterWeaponInstant::SpawnHitEffects(const FHitResult& Impact, const FVector& EndTrace)
+{
 	if (Impact.bBlockingHit)
 	{
 		SpawnImpactEffects(Impact);
@@ -190,84 +339,345 @@ void AShooterWeaponInstant::SimulateInstantHit(const FVector& ImpactPoint)
 }
 
 
-bool AShooterWeaponInstant::ServerNotifyHit_Validate(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir)
+void AShooterWeaponInstant::ServerProcessShotHits(const FShooterShotRecord& Record)
 {
-	return true;
+	/* More hits than pellets can't come from this weapon, records without hits carry no origin */
+	if (Record.Hits.Hits.Num() == 0 || Record.Hits.Hits.Num() > FMath::Max(PelletCount, 1))
+	{
+		return;
+	}
+
+	ProcessPelletHitsConfirmed(Record.Hits, true, Record.Timestamp);
+}
+
+
+bool AShooterWeaponInstant::ServerValidateRewindHit(const FHitResult& Impact, const FVector& Origin, float ClientTimestamp, FShooterRewindHit& OutRewindHit, float& OutRejectDistance) const
+{
+	AActor* HitActor = Impact.GetActor();
+
+	/* Retrace the shot against the hitboxes where the client saw them. The trace start and end the client sent are
+	   never used, the line runs from the server side origin through the claimed impact point */
+	UShooterHitboxHistoryComponent* HitboxHistory = HitActor->FindComponentByClass<UShooterHitboxHistoryComponent>();
+	if (HitboxHistory)
+	{
+		const FVector TraceDir = (Impact.Location - Origin).GetSafeNormal();
+		const FVector TraceEnd = Impact.Location + TraceDir * RewindTraceOvershoot;
+
+		/* Bots whose movement the server steps were recorded less precisely than clients show them */
+		float Leeway = RewindHitLeeway;
+		UShooterAISignificanceManager* SignificanceManager = GetWorld()->GetSubsystem<UShooterAISignificanceManager>();
+		if (SignificanceManager)
+		{
+			Leeway += SignificanceManager->GetExtraRewindLeeway(Cast<APawn>(HitActor));
+		}
+
+		return HitboxHistory->RewindLineTrace(HitboxHistory->ClampRewindTimestamp(ClientTimestamp), Origin, TraceEnd, Leeway, OutRewindHit, &OutRejectDistance);
+	}
+
+	/* No history for this actor, fall back to a scaled bounding box around its current position */
+	const FBox HitBox = HitActor->GetComponentsBoundingBox();
+
+	FVector BoxExtent = 0.5 * (HitBox.Max - HitBox.Min);
+	BoxExtent *= ClientSideHitLeeway;
+
+	BoxExtent.X = FMath::Max(20.0f, BoxExtent.X);
+	BoxExtent.Y = FMath::Max(20.0f, BoxExtent.Y);
+	BoxExtent.Z = FMath::Max(20.0f, BoxExtent.Z);
+
+	const FVector BoxCenter = (HitBox.Min + HitBox.Max) * 0.5;
+
+	// If we are within client tolerance
+	if (FMath::Abs(Impact.Location.Z - BoxCenter.Z) < BoxExtent.Z &&
+		FMath::Abs(Impact.Location.X - BoxCenter.X) < BoxExtent.X &&
+		FMath::Abs(Impact.Location.Y - BoxCenter.Y) < BoxExtent.Y)
+	{
+		return true;
+	}
+
+	OutRejectDistance = FMath::Sqrt(FBox(BoxCenter - BoxExtent, BoxCenter + BoxExtent).ComputeSquaredDistanceToPoint(Impact.Location));
+	return false;
+}
+
+
+bool AShooterWeaponInstant::ServerValidateShotOrigin(const FVector& ClientOrigin, FVector& OutOrigin) const
+{
+	OutOrigin = GetMuzzleLocation();
+
+	const float MaxErrorSq = FMath::Square(MaxShotOriginError);
+	if (FVector::DistSquared(ClientOrigin, OutOrigin) <= MaxErrorSq)
+	{
+		return true;
+	}
+
+	/* Muzzle sockets of meshes that don't animate on dedicated servers lag behind, the view location doesn't */
+	return GetInstigator() && FVector::DistSquared(ClientOrigin, GetInstigator()->GetPawnViewLocation()) <= MaxErrorSq;
 }
 
 
-void AShooterWeaponInstant::ServerNotifyHit_Implementation(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir)
+int32 FShooterHitRegCounters::GetDistanceBucket(float Distance)
 {
-	// If we have an instigator, calculate the dot between the view and the shot
-	if (GetInstigator() && (Impact.GetActor() || Impact.bBlockingHit))
+	static const float BucketBounds[NumDistanceBuckets - 1] = { 10.0f, 25.0f, 50.0f, 100.0f, 250.0f };
+
+	int32 Bucket = 0;
+	while (Bucket < NumDistanceBuckets - 1 && Distance >= BucketBounds[Bucket])
 	{
-		const FVector Origin = GetMuzzleLocation();
-		const FVector ViewDir = (Impact.Location - Origin).GetSafeNormal();
+		Bucket++;
+	}
+
+	return Bucket;
+}
 
-		const float ViewDotHitDir = FVector::DotProduct(GetInstigator()->GetViewRotation().Vector(), ViewDir);
-		if (ViewDotHitDir > AllowedViewDotHitDir)
+
+void AShooterWeaponInstant::RecordHitReg(EShooterHitRegResult Result, float RejectDistance)
+{
+	if (!HitRegEndFrameHandle.IsValid())
+	{
+		HitRegEndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&FlushHitRegStats);
+	}
+
+	HitRegCounters.Results[(int32)Result]++;
+	FrameHitRegResults[(int32)Result].Increment();
+
+	if (Result == EShooterHitRegResult::RejectedBounds)
+	{
+		const int32 Bucket = FShooterHitRegCounters::GetDistanceBucket(RejectDistance);
+		HitRegCounters.RejectDistances[Bucket]++;
+		FrameHitRegRejectDistances[Bucket].Increment();
+	}
+}
+
+
+void AShooterWeaponInstant::FirePellets()
+{
+	const FVector AimDir = GetAdjustedAim();
+	const FVector CameraPos = GetCameraDamageStartLocation(AimDir);
+	const FVector EndPos = CameraPos + (AimDir * WeaponRange);
+
+	/* Pellets are centered on whatever is under the crosshair */
+	const FHitResult CenterImpact = WeaponTrace(CameraPos, EndPos);
+	const FVector MuzzleOrigin = GetMuzzleLocation();
+	const FVector CenterDir = ((CenterImpact.bBlockingHit ? CenterImpact.ImpactPoint : EndPos) - MuzzleOrigin).GetSafeNormal();
+
+	FCollisionQueryParams TraceParams(TEXT("WeaponTrace"), true, GetInstigator());
+	TraceParams.bReturnPhysicalMaterial = true;
+
+	const float ConeHalfAngle = FMath::DegreesToRadians(PelletSpread * 0.5f);
+
+	FShooterPelletHitBatch Batch;
+	Batch.Origin = MuzzleOrigin;
+	Batch.Hits.SetNum(PelletCount);
+
+	for (int32 i = 0; i < PelletCount; i++)
+	{
+		const FVector PelletEnd = MuzzleOrigin + FMath::VRandCone(CenterDir, ConeHalfAngle) * WeaponRange;
+
+		FHitResult Impact(ForceInit);
+		GetWorld()->LineTraceSingleByChannel(Impact, MuzzleOrigin, PelletEnd, COLLISION_WEAPON, TraceParams);
+
+		if (!Impact.bBlockingHit)
 		{
-			// TODO: Check for weapon state
+			Impact.ImpactPoint = PelletEnd;
+		}
+
+		Batch.Hits[i] = MakePelletHit(Impact);
+	}
 
-			if (Impact.GetActor() == nullptr)
+	ProcessPelletHits(Batch);
+}
+
+
+void AShooterWeaponInstant::ProcessPelletHits(const FShooterPelletHitBatch& Batch)
+{
+	/* All pellets go to the server with the shot */
+	if (bRecordingShot)
+	{
+		PendingShot.Hits = Batch;
+	}
+
+	ProcessPelletHitsConfirmed(Batch, false, 0.0f);
+}
+
+
+void AShooterWeaponInstant::ProcessPelletHitsConfirmed(const FShooterPelletHitBatch& Batch, bool bValidate, float ClientTimestamp)
+{
+	/* Summed damage per actor so each target takes a single damage event per shot */
+	struct FPelletDamage
+	{
+		FHitResult Impact;
+		FVector ShootDir;
+		float Damage;
+	};
+	TArray<FPelletDamage, TInlineAllocator<16>> Damages;
+
+	const FVector ViewDir = GetInstigator() ? GetInstigator()->GetViewRotation().Vector() : FVector::ZeroVector;
+
+	/* The client's origin is only checked, directions and rewind traces start at the server side muzzle */
+	FVector Origin = Batch.Origin;
+	if (bValidate && !ServerValidateShotOrigin(Batch.Origin, Origin))
+	{
+		RecordHitReg(EShooterHitRegResult::RejectedOrigin);
+		UE_LOG(LogGame, Verbose, TEXT("%s rejected shot: origin %.1f cm from the muzzle"), *GetName(), FVector::Dist(Batch.Origin, Origin));
+		return;
+	}
+
+	for (const FShooterPelletHit& Hit : Batch.Hits)
+	{
+		const FVector ShootDir = (Hit.ImpactPoint - Origin).GetSafeNormal();
+
+		if (bValidate)
+		{
+			const float ViewDotHitDir = FVector::DotProduct(ViewDir, ShootDir);
+			if (GetInstigator() == nullptr || ViewDotHitDir <= AllowedViewDotHitDir)
 			{
-				if (Impact.bBlockingHit)
-				{
-					ProcessInstantHitConfirmed(Impact, Origin, ShootDir);
-				}
+				RecordHitReg(EShooterHitRegResult::RejectedViewDot);
+				UE_LOG(LogGame, Verbose, TEXT("%s rejected hit on %s: view dot %.3f <= %.3f"), *GetName(), *GetNameSafe(Hit.HitActor), ViewDotHitDir, AllowedViewDotHitDir);
+				continue;
+			}
+		}
+
+		/* Only pellets that hit something need the full hit result */
+		if (Hit.HitActor == nullptr || !ShouldDealDamage(Hit.HitActor))
+		{
+			continue;
+		}
+
+		FHitResult Impact;
+		if (!BuildPelletImpact(Hit, Origin, Impact))
+		{
+			continue;
+		}
+
+		if (bValidate)
+		{
+			float RejectDistance = 0.0f;
+			FShooterRewindHit RewindHit;
+			if (Hit.HitActor->IsRootComponentStatic() || Hit.HitActor->IsRootComponentStationary())
+			{
+				RecordHitReg(EShooterHitRegResult::StaticAccepted);
 			}
-				// Assume it told the truth about static things because we don't move and the hit
-				// usually doesn't have significant gameplay implications
-			else if (Impact.GetActor()->IsRootComponentStatic() || Impact.GetActor()->IsRootComponentStationary())
+			else if (ServerValidateRewindHit(Impact, Origin, ClientTimestamp, RewindHit, RejectDistance))
 			{
-				ProcessInstantHitConfirmed(Impact, Origin, ShootDir);
+				RecordHitReg(EShooterHitRegResult::Accepted);
+
+				/* Damage zone comes from the rewound hitbox, the bone the client claimed is only a hint */
+				if (RewindHit.HitboxIndex != INDEX_NONE)
+				{
+					SetImpactBone(Impact, RewindHit.BoneName);
+				}
 			}
 			else
 			{
-				const FBox HitBox = Impact.GetActor()->GetComponentsBoundingBox();
+				RecordHitReg(EShooterHitRegResult::RejectedBounds, RejectDistance);
+				UE_LOG(LogGame, Verbose, TEXT("%s rejected hit on %s: %.1f cm outside the hitboxes"), *GetName(), *GetNameSafe(Hit.HitActor), RejectDistance);
+				continue;
+			}
+		}
 
-				FVector BoxExtent = 0.5 * (HitBox.Max - HitBox.Min);
-				BoxExtent *= ClientSideHitLeeway;
+		const float Damage = GetHitDamage(Impact);
 
-				BoxExtent.X = FMath::Max(20.0f, BoxExtent.X);
-				BoxExtent.Y = FMath::Max(20.0f, BoxExtent.Y);
-				BoxExtent.Z = FMath::Max(20.0f, BoxExtent.Z);
+		FPelletDamage* Existing = Damages.FindByPredicate([&](const FPelletDamage& Entry) { return Entry.Impact.GetActor() == Hit.HitActor; });
+		if (Existing)
+		{
+			Existing->Damage += Damage;
+		}
+		else
+		{
+			Damages.Add({ Impact, ShootDir, Damage });
+		}
+	}
 
-				const FVector BoxCenter = (HitBox.Min + HitBox.Max) * 0.5;
+	for (const FPelletDamage& Entry : Damages)
+	{
+		/* Target may have been destroyed by an earlier entry (eg. exploding barrel) */
+		if (Entry.Impact.GetActor())
+		{
+			ApplyHitDamage(Entry.Impact, Entry.ShootDir, Entry.Damage);
+		}
+	}
 
-				// If we are within client tolerance
-				if (FMath::Abs(Impact.Location.Z - BoxCenter.Z) < BoxExtent.Z &&
-					FMath::Abs(Impact.Location.X - BoxCenter.X) < BoxExtent.X &&
-					FMath::Abs(Impact.Location.Y - BoxCenter.Y) < BoxExtent.Y)
-				{
-					ProcessInstantHitConfirmed(Impact, Origin, ShootDir);
-				}
-			}
+	if (Batch.Hits.Num() == 0)
+	{
+		return;
+	}
+
+	// Play FX on remote clients
+	if (HasAuthority())
+	{
+		for (const FShooterPelletHit& Hit : Batch.Hits)
+		{
+			ReplicatedImpacts.AddImpact(Hit.ImpactPoint);
 		}
 	}
 
-	// TODO: UE_LOG on failures & rejection
+	// Play FX locally
+	if (GetNetMode() != NM_DedicatedServer)
+	{
+		for (const FShooterPelletHit& Hit : Batch.Hits)
+		{
+			SimulateInstantHit(Hit.ImpactPoint);
+		}
+	}
 }
 
 
-bool AShooterWeaponInstant::ServerNotifyMiss_Validate(FVector_NetQuantizeNormal ShootDir)
+bool AShooterWeaponInstant::BuildPelletImpact(const FShooterPelletHit& Hit, const FVector& Origin, FHitResult& OutImpact) const
 {
+	if (Hit.HitActor == nullptr)
+	{
+		return false;
+	}
+
+	const FVector ShootDir = (Hit.ImpactPoint - Origin).GetSafeNormal();
+
+	OutImpact = FHitResult(Hit.HitActor, nullptr, Hit.ImpactPoint, -ShootDir);
+	OutImpact.bBlockingHit = Hit.bBlockingHit;
+	OutImpact.TraceStart = Origin;
+	OutImpact.TraceEnd = Origin + ShootDir * WeaponRange;
+
+	/* Surface is looked up from the hit body, on the server the bone is replaced by the rewound hitbox once validated */
+	USkeletalMeshComponent* SkelComp = Hit.BoneIndex != INDEX_NONE ? Hit.HitActor->FindComponentByClass<USkeletalMeshComponent>() : nullptr;
+	if (SkelComp)
+	{
+		SetImpactBone(OutImpact, SkelComp->GetBoneName(Hit.BoneIndex));
+	}
+	else if (UPrimitiveComponent* RootPrim = Cast<UPrimitiveComponent>(Hit.HitActor->GetRootComponent()))
+	{
+		OutImpact.Component = RootPrim;
+		FBodyInstance* BodyInstance = RootPrim->GetBodyInstance();
+		OutImpact.PhysMaterial = BodyInstance ? BodyInstance->GetSimplePhysicalMaterial() : nullptr;
+	}
+
 	return true;
 }
 
 
-void AShooterWeaponInstant::ServerNotifyMiss_Implementation(FVector_NetQuantizeNormal ShootDir)
+void AShooterWeaponInstant::SetImpactBone(FHitResult& Impact, FName BoneName) const
 {
-	const FVector Origin = GetMuzzleLocation();
-	const FVector EndTrace = Origin + (ShootDir * WeaponRange);
-
-	// Play on remote clients
-	HitImpactNotify = EndTrace;
-
-	if (GetNetMode() != NM_DedicatedServer)
+	USkeletalMeshComponent* SkelComp = Impact.GetActor() ? Impact.GetActor()->FindComponentByClass<USkeletalMeshComponent>() : nullptr;
+	if (SkelComp == nullptr)
 	{
-		SpawnTrailEffects(EndTrace);
+		return;
 	}
+
+	FBodyInstance* BodyInstance = SkelComp->GetBodyInstance(BoneName);
+
+	Impact.Component = SkelComp;
+	Impact.BoneName = BoneName;
+	Impact.PhysMaterial = BodyInstance ? BodyInstance->GetSimplePhysicalMaterial() : nullptr;
+}
+
+
+FShooterPelletHit AShooterWeaponInstant::MakePelletHit(const FHitResult& Impact)
+{
+	FShooterPelletHit Hit;
+	Hit.bBlockingHit = Impact.bBlockingHit;
+	Hit.ImpactPoint = Impact.ImpactPoint;
+	Hit.HitActor = Impact.GetActor();
+
+	USkeletalMeshComponent* SkelComp = Cast<USkeletalMeshComponent>(Impact.GetComponent());
+	Hit.BoneIndex = SkelComp ? SkelComp->GetBoneIndex(Impact.BoneName) : INDEX_NONE;
+
+	return Hit;
 }
 
 
@@ -275,16 +685,10 @@ void AShooterWeaponInstant::SpawnImpactEffects(const FHitResult& Impact)
 {
 	if (ImpactTemplate && Impact.bBlockingHit)
 	{
-		// TODO: Possible re-trace to get hit component that is lost during replication.
-
-		/* This function prepares an actor to spawn, but requires another call to finish the actual spawn progress. This allows manipulation of properties before entering into the level */
-		AShooterImpactEffect* EffectActor = GetWorld()->SpawnActorDeferred<AShooterImpactEffect>(
-			ImpactTemplate, FTransform(Impact.ImpactPoint.Rotation(), Impact.ImpactPoint));
-		if (EffectActor)
+		UShooterFXManager* FXManager = GetWorld()->GetSubsystem<UShooterFXManager>();
+		if (FXManager)
 		{
-			EffectActor->SurfaceHit = Impact;
-			UGameplayStatics::FinishSpawningActor(EffectActor,
-			                                      FTransform(Impact.ImpactNormal.Rotation(), Impact.ImpactPoint));
+			FXManager->SpawnImpactEffects(ImpactTemplate, Impact);
 		}
 	}
 }
@@ -304,39 +708,96 @@ void AShooterWeaponInstant::SpawnTrailEffects(const FVector& EndPoint)
 		return;
 	}
 
+	UShooterFXManager* FXManager = GetWorld()->GetSubsystem<UShooterFXManager>();
+	if (FXManager == nullptr)
+	{
+		return;
+	}
+
+	AShooterCharacter* OwningPawn = GetPawnOwner();
+	const bool bLocallyControlled = OwningPawn && OwningPawn->IsLocallyControlled();
+
+	/* Other players' shots that are far away or off screen cost nothing */
+	if (!bLocallyControlled && !FXManager->IsTrailVisible(Origin, EndPoint, MaxTrailDrawDistance))
+	{
+		return;
+	}
+
 	if (BulletsShotCount % TracerRoundInterval == 0)
 	{
-		if (TracerFX)
-		{
-			ShootDir.Normalize();
-			UGameplayStatics::SpawnEmitterAtLocation(this, TracerFX, Origin, ShootDir.Rotation());
-		}
+		FXManager->SpawnTrail(GetClass(), TrailPoolSize, true, TracerFX, Origin, EndPoint, TrailTargetParam);
 	}
 	else
 	{
 		// Only create trails FX by other players.
-		AShooterCharacter* OwningPawn = GetPawnOwner();
-		if (OwningPawn && OwningPawn->IsLocallyControlled())
+		if (bLocallyControlled)
 		{
 			return;
 		}
 
-		if (TrailFX)
+		FXManager->SpawnTrail(GetClass(), TrailPoolSize, false, TrailFX, Origin, EndPoint, TrailTargetParam);
+	}
+}
+
+
+void FShooterImpactRing::AddImpact(const FVector& ImpactPoint)
+{
+	FShooterImpactEntry& Entry = Items.Num() < Capacity ? Items.AddDefaulted_GetRef() : Items[NextSlot];
+	NextSlot = (NextSlot + 1) % Capacity;
+
+	Entry.ImpactPoint = ImpactPoint;
+	Entry.Sequence = NextSequence++;
+
+	MarkItemDirty(Entry);
+}
+
+
+void FShooterImpactEntry::PostReplicatedAdd(const FShooterImpactRing& InArraySerializer)
+{
+	/* Callbacks only get the serializer as const, the pending list is client side bookkeeping */
+	FShooterImpactRing& Ring = const_cast<FShooterImpactRing&>(InArraySerializer);
+	Ring.ReceivedIndices.Add(static_cast<int32>(this - Ring.Items.GetData()));
+}
+
+
+void FShooterImpactEntry::PostReplicatedChange(const FShooterImpactRing& InArraySerializer)
+{
+	PostReplicatedAdd(InArraySerializer);
+}
+
+
+void FShooterImpactRing::PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters)
+{
+	if (ReceivedIndices.Num() == 0)
+	{
+		return;
+	}
+
+	ReceivedIndices.Sort([this](int32 A, int32 B) { return (int16)(Items[A].Sequence - Items[B].Sequence) < 0; });
+
+	/* Becoming relevant sends the whole ring, only the newest impact is still current */
+	if (!bHasPlayed)
+	{
+		LastPlayedSequence = Items[ReceivedIndices.Last()].Sequence - 1;
+		bHasPlayed = true;
+	}
+
+	for (int32 Index : ReceivedIndices)
+	{
+		const FShooterImpactEntry& Entry = Items[Index];
+		if ((int16)(Entry.Sequence - LastPlayedSequence) > 0)
 		{
-			UParticleSystemComponent* TrailPSC = UGameplayStatics::SpawnEmitterAtLocation(this, TrailFX, Origin);
-			if (TrailPSC)
+			LastPlayedSequence = Entry.Sequence;
+
+			// Played on all remote clients
+			if (Owner)
 			{
-				TrailPSC->SetVectorParameter(TrailTargetParam, EndPoint);
+				Owner->SimulateInstantHit(Entry.ImpactPoint);
 			}
 		}
 	}
-}
 
-
-void AShooterWeaponInstant::OnRep_HitLocation()
-{
-	// Played on all remote clients
-	SimulateInstantHit(HitImpactNotify);
+	ReceivedIndices.Reset();
 }
 
 
@@ -344,5 +805,5 @@ void AShooterWeaponInstant::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME_CONDITION(AShooterWeaponInstant, HitImpactNotify, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(AShooterWeaponInstant, ReplicatedImpacts, COND_SkipOwner);
 }
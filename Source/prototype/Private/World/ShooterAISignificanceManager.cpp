@@ -0,0 +1,336 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterAISignificanceManager.h"
+#include "World/ShooterPawnRegistry.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "BrainComponent.h"
+#include "AIController.h"
+#include "prototype/prototype.h"
+
+
+static int32 AISignificanceEnabled = 1;
+FAutoConsoleVariableRef CVARAISignificanceEnabled(
+	TEXT("COOP.AISignificance"),
+	AISignificanceEnabled,
+	TEXT("Move bots between tick tiers by distance to players, 0 keeps every bot at full rate"),
+	ECVF_Default);
+
+static float AIFullRateDistance = 3000.0f;
+FAutoConsoleVariableRef CVARAIFullRateDistance(
+	TEXT("COOP.AIFullRateDistance"),
+	AIFullRateDistance,
+	TEXT("Bots closer to a player than this tick at full rate"),
+	ECVF_Default);
+
+static float AIReducedRateDistance = 8000.0f;
+FAutoConsoleVariableRef CVARAIReducedRateDistance(
+	TEXT("COOP.AIReducedRateDistance"),
+	AIReducedRateDistance,
+	TEXT("Bots closer to a player than this tick at reduced rate, bots further away go dormant"),
+	ECVF_Default);
+
+static float AISignificanceInterval = 0.25f;
+FAutoConsoleVariableRef CVARAISignificanceInterval(
+	TEXT("COOP.AISignificanceInterval"),
+	AISignificanceInterval,
+	TEXT("Seconds between two significance passes"),
+	ECVF_Default);
+
+/* Bots behind the nearest player count as this much further away */
+static const float OutOfViewDistanceScale = 2.0f;
+
+/* Cosine of the half angle of the view cone */
+static const float InViewCosine = 0.5f;
+
+/* Demotions need this much more distance than promotions, so bots on a boundary don't flip every pass */
+static const float TierHysteresis = 1.1f;
+
+
+struct FShooterAITierSettings
+{
+	float ActorTickInterval;
+
+	/* Character movement, moves the hitboxes the server rewinds hits against. Dedicated servers only */
+	float MovementTickInterval;
+
+	float PathFollowingTickInterval;
+
+	/* Skeletal mesh, which ticks the animation and poses the hitboxes. Dedicated servers only */
+	float AnimTickInterval;
+
+	/* Behavior tree */
+	float BrainTickInterval;
+
+	/* Applied to the sensing interval of the bot by the perception manager */
+	float SensingIntervalScale;
+};
+
+static const FShooterAITierSettings AITierSettings[(int32)EShooterAITickTier::Num] =
+{
+	/* Full */
+	{ 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f },
+	/* Reduced, still within weapon range so the pose players shoot at stays at full rate */
+	{ 0.1f, 0.0f, 0.05f, 0.0f, 0.1f, 2.0f },
+	/* Dormant, large movement steps are all the simulation a bot no one sees needs. Hits get extra rewind leeway */
+	{ 0.5f, 0.25f, 0.25f, 0.25f, 0.5f, 4.0f }
+};
+
+
+/* Only a dedicated server has no local viewer that would see stepped movement and animation */
+static bool CanStepSimulation(const APawn* Bot)
+{
+	return Bot->GetNetMode() == NM_DedicatedServer;
+}
+
+
+DECLARE_CYCLE_STAT(TEXT("AI Significance Update"), STAT_ShooterAISignificance, STATGROUP_ShooterAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bots Full Rate"), STAT_ShooterAIFullRate, STATGROUP_ShooterAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bots Reduced Rate"), STAT_ShooterAIReducedRate, STATGROUP_ShooterAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bots Dormant"), STAT_ShooterAIDormant, STATGROUP_ShooterAI);
+
+
+UShooterAISignificanceManager::UShooterAISignificanceManager()
+{
+	UpdateCount = 0;
+	TimeUntilUpdate = 0.0f;
+}
+
+
+bool UShooterAISignificanceManager::ShouldCreateSubsystem(UObject* Outer) const
+{
+	if (!Super::ShouldCreateSubsystem(Outer))
+	{
+		return false;
+	}
+
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+
+void UShooterAISignificanceManager::Deinitialize()
+{
+	Bots.Empty();
+	ViewerLocations.Empty();
+	ViewerDirections.Empty();
+
+	Super::Deinitialize();
+}
+
+
+void UShooterAISignificanceManager::Tick(float DeltaTime)
+{
+	TimeUntilUpdate -= DeltaTime;
+	if (TimeUntilUpdate <= 0.0f)
+	{
+		TimeUntilUpdate = AISignificanceInterval;
+		UpdateSignificance();
+	}
+}
+
+
+ETickableTickType UShooterAISignificanceManager::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+
+bool UShooterAISignificanceManager::IsTickable() const
+{
+	/* Clients only simulate bots, stretching their movement smoothing and animation would only show as stutter */
+	return GetWorld()->GetNetMode() != NM_Client;
+}
+
+
+UWorld* UShooterAISignificanceManager::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+
+TStatId UShooterAISignificanceManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterAISignificanceManager, STATGROUP_Tickables);
+}
+
+
+EShooterAITickTier UShooterAISignificanceManager::GetTier(APawn* Bot) const
+{
+	const FShooterAISignificance* Significance = Bots.Find(Bot);
+	return Significance ? Significance->Tier : EShooterAITickTier::Full;
+}
+
+
+float UShooterAISignificanceManager::GetSensingIntervalScale(APawn* Bot) const
+{
+	return AITierSettings[(int32)GetTier(Bot)].SensingIntervalScale;
+}
+
+
+float UShooterAISignificanceManager::GetExtraRewindLeeway(APawn* Bot) const
+{
+	const ACharacter* Character = Cast<ACharacter>(Bot);
+	if (Character == nullptr || !CanStepSimulation(Bot))
+	{
+		return 0.0f;
+	}
+
+	/* Clients interpolate between the steps, the recorded pose is off by up to half a step */
+	const float MovementTickInterval = AITierSettings[(int32)GetTier(Bot)].MovementTickInterval;
+	return Character->GetCharacterMovement()->GetMaxSpeed() * MovementTickInterval * 0.5f;
+}
+
+
+void UShooterAISignificanceManager::UpdateSignificance()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterAISignificance);
+
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (!PawnRegistry)
+	{
+		return;
+	}
+
+	UpdateCount++;
+
+	ViewerLocations.Reset();
+	ViewerDirections.Reset();
+	PawnRegistry->ForEachPawn(EShooterPawnKind::Player, true, [this](APawn* Player)
+	{
+		ViewerLocations.Add(Player->GetPawnViewLocation());
+		ViewerDirections.Add(Player->GetViewRotation().Vector());
+	});
+
+	int32 TierCounts[(int32)EShooterAITickTier::Num] = { 0 };
+
+	auto UpdateBot = [&](APawn* Bot)
+	{
+		FShooterAISignificance* Significance = Bots.Find(Bot);
+		if (!Significance)
+		{
+			/* Starts at full rate, which is what the bot was created with */
+			Significance = &Bots.Add(Bot);
+			Significance->Tier = EShooterAITickTier::Full;
+		}
+
+		Significance->LastUpdate = UpdateCount;
+
+		const EShooterAITickTier NewTier = AISignificanceEnabled ? ScoreBot(Bot, Significance->Tier) : EShooterAITickTier::Full;
+		if (NewTier != Significance->Tier)
+		{
+			Significance->Tier = NewTier;
+			ApplyTier(Bot, NewTier);
+		}
+
+		TierCounts[(int32)NewTier]++;
+	};
+
+	PawnRegistry->ForEachPawn(EShooterPawnKind::Bot, true, UpdateBot);
+	PawnRegistry->ForEachPawn(EShooterPawnKind::TrackerBot, true, UpdateBot);
+
+	/* Bots that died or unregistered since the last pass go back to full rate */
+	for (auto It = Bots.CreateIterator(); It; ++It)
+	{
+		if (It.Value().LastUpdate != UpdateCount)
+		{
+			APawn* Bot = It.Key().Get();
+			if (Bot && It.Value().Tier != EShooterAITickTier::Full)
+			{
+				ApplyTier(Bot, EShooterAITickTier::Full);
+			}
+
+			It.RemoveCurrent();
+		}
+	}
+
+	SET_DWORD_STAT(STAT_ShooterAIFullRate, TierCounts[(int32)EShooterAITickTier::Full]);
+	SET_DWORD_STAT(STAT_ShooterAIReducedRate, TierCounts[(int32)EShooterAITickTier::Reduced]);
+	SET_DWORD_STAT(STAT_ShooterAIDormant, TierCounts[(int32)EShooterAITickTier::Dormant]);
+}
+
+
+EShooterAITickTier UShooterAISignificanceManager::ScoreBot(const APawn* Bot, EShooterAITickTier CurrentTier) const
+{
+	const FVector BotLocation = Bot->GetActorLocation();
+
+	/* Distance to the nearest viewer, scaled up if the bot is outside of that viewer's view */
+	float BestDistSq = BIG_NUMBER;
+	int32 BestViewer = INDEX_NONE;
+	for (int32 i = 0; i < ViewerLocations.Num(); i++)
+	{
+		const float DistSq = FVector::DistSquared(ViewerLocations[i], BotLocation);
+		if (DistSq < BestDistSq)
+		{
+			BestDistSq = DistSq;
+			BestViewer = i;
+		}
+	}
+
+	if (BestViewer == INDEX_NONE)
+	{
+		return EShooterAITickTier::Dormant;
+	}
+
+	float Distance = FMath::Sqrt(BestDistSq);
+
+	const FVector ToBot = (BotLocation - ViewerLocations[BestViewer]).GetSafeNormal();
+	if ((ViewerDirections[BestViewer] | ToBot) < InViewCosine)
+	{
+		Distance *= OutOfViewDistanceScale;
+	}
+
+	auto GetTierAt = [Distance](float Scale)
+	{
+		if (Distance < AIFullRateDistance * Scale)
+		{
+			return EShooterAITickTier::Full;
+		}
+
+		return Distance < AIReducedRateDistance * Scale ? EShooterAITickTier::Reduced : EShooterAITickTier::Dormant;
+	};
+
+	EShooterAITickTier NewTier = GetTierAt(1.0f);
+	if (NewTier > CurrentTier)
+	{
+		NewTier = FMath::Max(GetTierAt(TierHysteresis), CurrentTier);
+	}
+
+	return NewTier;
+}
+
+
+void UShooterAISignificanceManager::ApplyTier(APawn* Bot, EShooterAITickTier Tier)
+{
+	const FShooterAITierSettings& Settings = AITierSettings[(int32)Tier];
+
+	Bot->SetActorTickInterval(Settings.ActorTickInterval);
+
+	ACharacter* Character = Cast<ACharacter>(Bot);
+	if (Character && CanStepSimulation(Bot))
+	{
+		Character->GetCharacterMovement()->SetComponentTickInterval(Settings.MovementTickInterval);
+
+		if (Character->GetMesh())
+		{
+			Character->GetMesh()->SetComponentTickInterval(Settings.AnimTickInterval);
+		}
+	}
+
+	AAIController* AIController = Cast<AAIController>(Bot->GetController());
+	if (AIController)
+	{
+		if (AIController->GetPathFollowingComponent())
+		{
+			AIController->GetPathFollowingComponent()->SetComponentTickInterval(Settings.PathFollowingTickInterval);
+		}
+
+		if (AIController->GetBrainComponent())
+		{
+			AIController->GetBrainComponent()->SetComponentTickInterval(Settings.BrainTickInterval);
+		}
+	}
+}
@@ -6,7 +6,7 @@
 #include "ShooterPlayerState.h"
 #include "ShooterCharacter.h"
 #include "World/ShooterGameState.h"
-#include "EngineUtils.h"
+#include "World/ShooterPawnRegistry.h"
 #include "ShooterPlayerController.h"
 
 
@@ -54,16 +54,13 @@ void AShooterBattleGameMode::RestartPlayer(class AController* NewPlayer)
 	/* Look for a live player to spawn next to */
 	FVector SpawnOrigin = FVector::ZeroVector;
 	FRotator StartRotation = FRotator::ZeroRotator;
-	for (TActorIterator<APawn> It(GetWorld()); It; ++It)
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	APawn* AlivePlayer = PawnRegistry ? PawnRegistry->GetFirstPawn(EShooterPawnKind::Player, true) : nullptr;
+	if (AlivePlayer)
 	{
-		AShooterCharacter* MyCharacter = Cast<AShooterCharacter>(*It);
-		if (MyCharacter && MyCharacter->IsAlive())
-		{
-			/* Get the origin of the first player we can find */
-			SpawnOrigin = MyCharacter->GetActorLocation();
-			StartRotation = MyCharacter->GetActorRotation();
-			break;
-		}
+		/* Get the origin of the first player we can find */
+		SpawnOrigin = AlivePlayer->GetActorLocation();
+		StartRotation = AlivePlayer->GetActorRotation();
 	}
 
 	/* No player is alive (yet) - spawn using one of the PlayerStarts */
@@ -8,7 +8,8 @@
 #include "AI/ShooterAICharacter.h"
 #include "AI/ShooterVIPCharacter.h"
 #include "World/ShooterGameState.h"
-#include "EngineUtils.h"
+#include "World/ShooterPawnRegistry.h"
+#include "Components/ShooterWaveDirectorComponent.h"
 #include "ShooterPlayerController.h"
 #include "TimerManager.h"
 #include "AI/ShooterVIPCharacter.h"
@@ -34,6 +35,21 @@ AShooterCoopGameMode::AShooterCoopGameMode()
 	MaxWaveCount = 3;
 
 	OneWaveMaxDuration = 60;
+
+	WaveDirector = CreateDefaultSubobject<UShooterWaveDirectorComponent>(TEXT("WaveDirector"));
+	WaveDirector->OnWaveSpawningFinished.BindUObject(this, &AShooterCoopGameMode::OnWaveSpawningFinished);
+}
+
+
+void AShooterCoopGameMode::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (PawnRegistry)
+	{
+		PawnRegistry->OnAlivePawnCountChanged.AddUObject(this, &AShooterCoopGameMode::OnAlivePawnCountChanged);
+	}
 }
 
 
@@ -52,23 +68,13 @@ void AShooterCoopGameMode::RestartPlayer(class AController* NewPlayer)
 	/* Look for a live player to spawn next to */
 	FVector SpawnOrigin = FVector::ZeroVector;
 	FRotator StartRotation = FRotator::ZeroRotator;
-	for (TActorIterator<APawn> It(GetWorld()); It; ++It)
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	APawn* AlivePlayer = PawnRegistry ? PawnRegistry->GetFirstPawn(EShooterPawnKind::Player, true) : nullptr;
+	if (AlivePlayer)
 	{
-		AShooterAICharacter* Char = Cast<AShooterAICharacter>(*It);
-		if (Char)
-		{
-			//UE_LOG(LogTemp, Log, TEXT("Respawn: Not Player"));
-			continue;
-		}
-		AShooterCharacter* MyCharacter = Cast<AShooterCharacter>(*It);
-
-		if (MyCharacter && MyCharacter->IsAlive())
-		{
-			/* Get the origin of the first player we can find */
-			SpawnOrigin = MyCharacter->GetActorLocation();
-			StartRotation = MyCharacter->GetActorRotation();
-			break;
-		}
+		/* Get the origin of the first player we can find */
+		SpawnOrigin = AlivePlayer->GetActorLocation();
+		StartRotation = AlivePlayer->GetActorRotation();
 	}
 
 	/* No player is alive (yet) - spawn using one of the PlayerStarts */
@@ -180,16 +186,11 @@ void AShooterCoopGameMode::Killed(AController* Killer, AController* VictimPlayer
 			AShooterGameState* GS = GetGameState<AShooterGameState>();
 			if (ensureAlways(GS))
 			{
-				GS->PlayerRespawnCount = PlayerRespawnCount;
+				GS->SetPlayerRespawnCount(PlayerRespawnCount);
 			}
 
 		}
 
-		if (VictimPS->IsABot())
-		{
-			CheckWaveState();
-		}
-
 		CheckMatchEnd();
 
 		if(Cast<AShooterVIPCharacter>(VictimPlayer->GetCharacter()))
@@ -236,6 +237,9 @@ void AShooterCoopGameMode::StartMatch()
 {
 	Super::StartMatch();
 
+	/* Create the wave bots up front while players wait for the first wave */
+	StartBotPoolPrewarm(TimeBeforeGameStart);
+
 	GetWorldTimerManager().SetTimer(TimerHandle_GameStart, this, &AShooterCoopGameMode::StartWave, TimeBeforeGameStart,
 	                                false);
 }
@@ -248,7 +252,7 @@ void AShooterCoopGameMode::FinishMatch(bool IsWin)
 		AShooterGameState* GS = GetGameState<AShooterGameState>();
 		if (ensureAlways(GS))
 		{
-			GS->GameIsWin = IsWin;
+			GS->SetGameIsWin(IsWin);
 		}
 
 		EndMatch();
@@ -278,15 +282,11 @@ void AShooterCoopGameMode::StartWave()
 	if (ensureAlways(GS))
 	{
 		GS->SetWaveCount(WaveCount);
-		GS->NextWaveStartTime = GS->ElapsedGameSeconds + OneWaveMaxDuration;
+		GS->SetNextWaveStartTime(FMath::CeilToInt(GS->GetElapsedGameSeconds()) + OneWaveMaxDuration);
 	}
 
-	NrOfBotsToSpawn = 2 * WaveCount;
-
-
-
-	GetWorldTimerManager().SetTimer(TimerHandle_BotSpawner, this, &AShooterCoopGameMode::SpawnBotTimerElapsed, 1.0f,
-	                                true, 0.0f);
+	/* The director may shrink the wave when the server is busy */
+	WaveDirector->StartWave(2 * WaveCount);
 
 	GetWorldTimerManager().SetTimer(TimerHandle_OneWaveMaxDuration, this, &AShooterCoopGameMode::StartWave, OneWaveMaxDuration,
 		false);
@@ -297,7 +297,9 @@ void AShooterCoopGameMode::StartWave()
 
 void AShooterCoopGameMode::EndWave()
 {
-	GetWorldTimerManager().ClearTimer(TimerHandle_BotSpawner);
+	WaveDirector->StopWave();
+
+	ReportBotSpawnLatency(WaveCount);
 
 	SetWaveState(EWaveState::WaitingToComplete);
 }
@@ -314,40 +316,49 @@ void AShooterCoopGameMode::PrepareForNextWave()
 
 void AShooterCoopGameMode::CheckWaveState()
 {
-	bool bIsPreparingForWave = GetWorldTimerManager().IsTimerActive(TimerHandle_PrepareForNextWaveStart);
-
-	if (NrOfBotsToSpawn > 0 || bIsPreparingForWave)
+	/* Only a wave that finished spawning can complete */
+	if (WaveState != EWaveState::WaitingToComplete)
 	{
 		return;
 	}
 
-	bool bIsAnyBotAlive = false;
+	/* Players, the VIP and tracker bots don't hold the wave back */
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	const bool bIsAnyBotAlive = PawnRegistry && PawnRegistry->GetNumPawns(EShooterPawnKind::Bot, true) > 0;
 
-	for (TActorIterator<AShooterBaseCharacter> It(GetWorld()); It; ++It)
+	if (!bIsAnyBotAlive)
 	{
-		AShooterBaseCharacter* Character = *It;
-		if (Character == nullptr || Character->IsPlayerControlled())
-		{
-			continue;
-		}
+		SetWaveState(EWaveState::WaveComplete);
 
-		if(Cast<AShooterVIPCharacter>(Character))
-		{
-			continue;
-		}
+		PrepareForNextWave();
+	}
+}
 
-		if (Character && Character->GetHealth() > 0.0f)
-		{
-			bIsAnyBotAlive = true;
-			break;
-		}
+
+void AShooterCoopGameMode::OnWaveSpawningFinished()
+{
+	EndWave();
+
+	CheckWaveState();
+}
+
+
+void AShooterCoopGameMode::OnAlivePawnCountChanged(EShooterPawnKind Kind, int32 NumAlive)
+{
+	if (Kind != EShooterPawnKind::Bot)
+	{
+		return;
 	}
 
-	if (!bIsAnyBotAlive)
+	AShooterGameState* GS = GetGameState<AShooterGameState>();
+	if (GS)
 	{
-		SetWaveState(EWaveState::WaveComplete);
+		GS->SetNumBotsAlive(NumAlive);
+	}
 
-		PrepareForNextWave();
+	if (NumAlive == 0)
+	{
+		CheckWaveState();
 	}
 }
 
@@ -395,8 +406,8 @@ void AShooterCoopGameMode::InitGameState()
 	AShooterGameState* MyGameState = Cast<AShooterGameState>(GameState);
 	if (MyGameState)
 	{
-		MyGameState->NextWaveStartTime = TimeBeforeGameStart;
-		MyGameState->PlayerRespawnCount = PlayerRespawnCount;
+		MyGameState->SetNextWaveStartTime(TimeBeforeGameStart);
+		MyGameState->SetPlayerRespawnCount(PlayerRespawnCount);
 	}
 }
 
@@ -415,15 +426,3 @@ void AShooterCoopGameMode::InitGameState()
 //
 //	CheckWaveState();
 //}
-
-void AShooterCoopGameMode::SpawnBotTimerElapsed()
-{
-	SpawnNewBot();
-
-	NrOfBotsToSpawn--;
-
-	if (NrOfBotsToSpawn <= 0)
-	{
-		EndWave();
-	}
-}
@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterDamageProfileSubsystem.h"
+#include "ShooterDamageType.h"
+#include "Engine/GameInstance.h"
+#include "UObject/UObjectIterator.h"
+#include "prototype/prototype.h"
+
+
+void UShooterDamageProfileSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	AddProfile(nullptr);
+
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		if (Class->IsChildOf(UShooterDamageType::StaticClass()) && !Class->HasAnyClassFlags(CLASS_Abstract | CLASS_NewerVersionExists)
+			&& !Class->GetName().StartsWith(TEXT("SKEL_")) && !Class->GetName().StartsWith(TEXT("REINST_")))
+		{
+			AddProfile(Class);
+		}
+	}
+}
+
+
+void UShooterDamageProfileSubsystem::Deinitialize()
+{
+	ProfileIndices.Empty();
+	Multipliers.Empty();
+	CanDieFlags.Empty();
+
+	Super::Deinitialize();
+}
+
+
+UShooterDamageProfileSubsystem* UShooterDamageProfileSubsystem::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+
+	return GameInstance ? GameInstance->GetSubsystem<UShooterDamageProfileSubsystem>() : nullptr;
+}
+
+
+int32 UShooterDamageProfileSubsystem::GetProfileIndex(TSubclassOf<UDamageType> DamageTypeClass)
+{
+	if (DamageTypeClass == nullptr || !DamageTypeClass->IsChildOf(UShooterDamageType::StaticClass()))
+	{
+		return DefaultProfileIndex;
+	}
+
+	const int32* ProfileIndex = ProfileIndices.Find(DamageTypeClass);
+	return ProfileIndex ? *ProfileIndex : AddProfile(DamageTypeClass);
+}
+
+
+int32 UShooterDamageProfileSubsystem::AddProfile(UClass* DamageTypeClass)
+{
+	const int32 ProfileIndex = CanDieFlags.Num();
+	const UShooterDamageType* DmgType = DamageTypeClass ? DamageTypeClass->GetDefaultObject<UShooterDamageType>() : nullptr;
+
+	float* Row = &Multipliers[Multipliers.AddUninitialized(SurfaceType_Max)];
+	for (int32 i = 0; i < SurfaceType_Max; i++)
+	{
+		Row[i] = 1.0f;
+	}
+
+	if (DmgType)
+	{
+		/* Same surfaces the physics assets of players and zombies use for their body parts */
+		Row[SURFACE_ZOMBIEHEAD] = DmgType->GetHeadDamageModifier();
+		Row[SURFACE_FLESHVULNERABLE] = DmgType->GetHeadDamageModifier();
+		Row[SURFACE_ZOMBIELIMB] = DmgType->GetLimbDamageModifier();
+		Row[SURFACE_FLESHDEFAULT] = DmgType->GetLimbDamageModifier();
+	}
+
+	CanDieFlags.Add(DmgType == nullptr || DmgType->GetCanDieFrom());
+
+	if (DamageTypeClass)
+	{
+		ProfileIndices.Add(DamageTypeClass, ProfileIndex);
+	}
+
+	return ProfileIndex;
+}
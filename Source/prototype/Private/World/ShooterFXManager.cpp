@@ -0,0 +1,384 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterFXManager.h"
+#include "ShooterImpactEffect.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Components/DecalComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "Kismet/GameplayStatics.h"
+#include "GameFramework/WorldSettings.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Sound/SoundCue.h"
+#include "prototype/prototype.h"
+
+static int32 ImpactEmitterPoolSize = 32;
+FAutoConsoleVariableRef CVARImpactEmitterPoolSize(
+	TEXT("COOP.ImpactFX.EmitterPoolSize"),
+	ImpactEmitterPoolSize,
+	TEXT("Number of pooled impact emitters, read when the pool is created"),
+	ECVF_Default);
+
+static int32 MaxImpactDecals = 64;
+FAutoConsoleVariableRef CVARMaxImpactDecals(
+	TEXT("COOP.ImpactFX.MaxDecals"),
+	MaxImpactDecals,
+	TEXT("Global cap on impact decals, read when the pool is created"),
+	ECVF_Default);
+
+static int32 MaxImpactsPerFrame = 8;
+FAutoConsoleVariableRef CVARMaxImpactsPerFrame(
+	TEXT("COOP.ImpactFX.MaxPerFrame"),
+	MaxImpactsPerFrame,
+	TEXT("Impacts started per frame, the rest are skipped"),
+	ECVF_Default);
+
+
+UShooterFXManager::UShooterFXManager()
+{
+	BudgetFrame = 0;
+	SpawnsThisFrame = 0;
+}
+
+
+bool UShooterFXManager::ShouldCreateSubsystem(UObject* Outer) const
+{
+	/* Purely cosmetic */
+	if (!Super::ShouldCreateSubsystem(Outer) || IsRunningDedicatedServer())
+	{
+		return false;
+	}
+
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+
+void UShooterFXManager::Deinitialize()
+{
+	for (UParticleSystemComponent* PSC : ImpactEmitters)
+	{
+		if (PSC)
+		{
+			PSC->DestroyComponent();
+		}
+	}
+
+	for (UDecalComponent* Decal : Decals)
+	{
+		if (Decal)
+		{
+			Decal->DestroyComponent();
+		}
+	}
+
+	for (TPair<UClass*, FShooterTrailPool>& Pair : TrailPools)
+	{
+		for (UParticleSystemComponent* PSC : Pair.Value.Tracers)
+		{
+			if (PSC)
+			{
+				PSC->DestroyComponent();
+			}
+		}
+
+		for (UParticleSystemComponent* PSC : Pair.Value.Trails)
+		{
+			if (PSC)
+			{
+				PSC->DestroyComponent();
+			}
+		}
+	}
+
+	ImpactEmitters.Empty();
+	Decals.Empty();
+	TrailPools.Empty();
+	EmitterUseTimes.Empty();
+	DecalUseTimes.Empty();
+	DecalExpireTimes.Empty();
+	ImpactTables.Empty();
+
+	Super::Deinitialize();
+}
+
+
+void UShooterFXManager::Prewarm()
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr || World->GetWorldSettings() == nullptr || ImpactEmitters.Num() > 0)
+	{
+		return;
+	}
+
+	const int32 NumEmitters = FMath::Max(1, ImpactEmitterPoolSize);
+	ImpactEmitters.Reserve(NumEmitters);
+	for (int32 i = 0; i < NumEmitters; i++)
+	{
+		ImpactEmitters.Add(CreatePooledEmitter());
+	}
+	EmitterUseTimes.Init(0.0f, NumEmitters);
+
+	const int32 NumDecals = FMath::Max(0, MaxImpactDecals);
+	Decals.Reserve(NumDecals);
+	for (int32 i = 0; i < NumDecals; i++)
+	{
+		UDecalComponent* Decal = NewObject<UDecalComponent>(World->GetWorldSettings(), NAME_None, RF_Transient);
+		Decal->bAllowAnyoneToDestroyMe = true;
+		Decal->SetVisibility(false);
+		Decal->RegisterComponentWithWorld(World);
+
+		Decals.Add(Decal);
+	}
+	DecalUseTimes.Init(0.0f, NumDecals);
+	DecalExpireTimes.Init(0.0f, NumDecals);
+}
+
+
+UParticleSystemComponent* UShooterFXManager::CreatePooledEmitter()
+{
+	UWorld* World = GetWorld();
+
+	/* Same setup as UGameplayStatics::SpawnEmitterAtLocation, but kept around after the effect finished */
+	UParticleSystemComponent* PSC = NewObject<UParticleSystemComponent>(World->GetWorldSettings(), NAME_None, RF_Transient);
+	PSC->bAutoDestroy = false;
+	PSC->bAutoActivate = false;
+	PSC->bAllowAnyoneToDestroyMe = true;
+	PSC->SetUsingAbsoluteLocation(true);
+	PSC->SetUsingAbsoluteRotation(true);
+	PSC->SetUsingAbsoluteScale(true);
+	PSC->RegisterComponentWithWorld(World);
+
+	return PSC;
+}
+
+
+UParticleSystemComponent* UShooterFXManager::AcquireEmitter(const TArray<UParticleSystemComponent*>& Components, TArray<float>& UseTimes)
+{
+	int32 PickedIdx = 0;
+	for (int32 i = 0; i < Components.Num(); i++)
+	{
+		if (!Components[i]->IsActive())
+		{
+			PickedIdx = i;
+			break;
+		}
+
+		if (UseTimes[i] < UseTimes[PickedIdx])
+		{
+			PickedIdx = i;
+		}
+	}
+
+	UseTimes[PickedIdx] = GetWorld()->GetTimeSeconds();
+	return Components[PickedIdx];
+}
+
+
+const FShooterImpactFXTable& UShooterFXManager::GetImpactTable(TSubclassOf<AShooterImpactEffect> ImpactTemplate)
+{
+	FShooterImpactFXTable* Table = ImpactTables.Find(ImpactTemplate);
+	if (Table == nullptr)
+	{
+		const AShooterImpactEffect* Settings = ImpactTemplate->GetDefaultObject<AShooterImpactEffect>();
+
+		Table = &ImpactTables.Add(ImpactTemplate);
+		Settings->BuildSurfaceTable(Table->FX, Table->Sounds);
+		Table->DecalMaterial = Settings->DecalMaterial;
+		Table->DecalSize = Settings->DecalSize;
+		Table->DecalLifeSpan = Settings->DecalLifeSpan;
+	}
+
+	return *Table;
+}
+
+
+bool UShooterFXManager::ConsumeSpawnBudget()
+{
+	if (BudgetFrame != GFrameCounter)
+	{
+		BudgetFrame = GFrameCounter;
+		SpawnsThisFrame = 0;
+	}
+
+	if (SpawnsThisFrame >= MaxImpactsPerFrame)
+	{
+		return false;
+	}
+
+	SpawnsThisFrame++;
+	return true;
+}
+
+
+void UShooterFXManager::SpawnImpactEffects(TSubclassOf<AShooterImpactEffect> ImpactTemplate, const FHitResult& Impact)
+{
+	if (ImpactTemplate == nullptr || !Impact.bBlockingHit || !ConsumeSpawnBudget())
+	{
+		return;
+	}
+
+	Prewarm();
+
+	const FShooterImpactFXTable& Table = GetImpactTable(ImpactTemplate);
+	const EPhysicalSurface HitSurfaceType = UPhysicalMaterial::DetermineSurfaceType(Impact.PhysMaterial.Get());
+
+	UParticleSystem* ImpactFX = Table.FX[HitSurfaceType];
+	if (ImpactFX && ImpactEmitters.Num() > 0)
+	{
+		UParticleSystemComponent* PSC = AcquireEmitter(ImpactEmitters, EmitterUseTimes);
+
+		if (PSC->Template != ImpactFX)
+		{
+			PSC->SetTemplate(ImpactFX);
+		}
+		PSC->SetWorldLocationAndRotation(Impact.ImpactPoint, Impact.ImpactNormal.Rotation());
+		PSC->ActivateSystem(true);
+	}
+
+	USoundCue* ImpactSound = Table.Sounds[HitSurfaceType];
+	if (ImpactSound)
+	{
+		UGameplayStatics::PlaySoundAtLocation(this, ImpactSound, Impact.ImpactPoint);
+	}
+
+	/* Pooled decals can't follow movable surfaces, they would stay behind on parked bots and sleeping props */
+	const UPrimitiveComponent* HitComponent = Impact.Component.Get();
+	if (Table.DecalMaterial && Decals.Num() > 0 && (HitComponent == nullptr || HitComponent->Mobility != EComponentMobility::Movable))
+	{
+		SpawnDecal(Table, Impact);
+	}
+}
+
+
+void UShooterFXManager::SpawnDecal(const FShooterImpactFXTable& Table, const FHitResult& Impact)
+{
+	const int32 DecalIdx = AcquireDecal();
+	UDecalComponent* Decal = Decals[DecalIdx];
+
+	FVector ImpactNormal = Impact.ImpactNormal;
+	ImpactNormal.Normalize();
+	/* Inverse to point towards the wall. Invert to get the correct orientation of the decal (pointing into the surface instead of away, messing with the normals, and lighting) */
+	ImpactNormal = -ImpactNormal;
+
+	FRotator RandomDecalRotation = ImpactNormal.ToOrientationRotator();
+	RandomDecalRotation.Roll = FMath::FRandRange(-180.0f, 180.0f);
+
+	Decal->SetDecalMaterial(Table.DecalMaterial);
+	Decal->DecalSize = FVector(Table.DecalSize, Table.DecalSize, Table.DecalSize);
+	Decal->SetWorldLocationAndRotation(Impact.ImpactPoint, RandomDecalRotation);
+
+	/* Set directly instead of SetFadeOut, which destroys the component once faded */
+	Decal->FadeStartDelay = Table.DecalLifeSpan;
+	Decal->FadeDuration = 0.5f;
+	Decal->SetVisibility(true);
+	Decal->MarkRenderStateDirty();
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	DecalUseTimes[DecalIdx] = Now;
+	DecalExpireTimes[DecalIdx] = Now + Table.DecalLifeSpan + Decal->FadeDuration;
+}
+
+
+int32 UShooterFXManager::AcquireDecal()
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	/* Lifespans differ per impact type, so the oldest decal isn't necessarily the first to expire */
+	int32 PickedIdx = INDEX_NONE;
+	int32 OldestIdx = 0;
+	for (int32 i = 0; i < Decals.Num(); i++)
+	{
+		if (DecalExpireTimes[i] > 0.0f && DecalExpireTimes[i] <= Now)
+		{
+			Decals[i]->SetVisibility(false);
+			DecalExpireTimes[i] = 0.0f;
+		}
+
+		if (DecalExpireTimes[i] == 0.0f)
+		{
+			if (PickedIdx == INDEX_NONE)
+			{
+				PickedIdx = i;
+			}
+		}
+		else if (DecalUseTimes[i] < DecalUseTimes[OldestIdx])
+		{
+			OldestIdx = i;
+		}
+	}
+
+	return PickedIdx != INDEX_NONE ? PickedIdx : OldestIdx;
+}
+
+
+void UShooterFXManager::SpawnTrail(UClass* WeaponClass, int32 PoolSize, bool bTracer, UParticleSystem* FX, const FVector& Origin, const FVector& EndPoint, FName TargetParam)
+{
+	if (WeaponClass == nullptr || FX == nullptr)
+	{
+		return;
+	}
+
+	FShooterTrailPool& Pool = TrailPools.FindOrAdd(WeaponClass);
+	TArray<UParticleSystemComponent*>& Components = bTracer ? Pool.Tracers : Pool.Trails;
+	TArray<float>& UseTimes = bTracer ? Pool.TracerUseTimes : Pool.TrailUseTimes;
+
+	if (Components.Num() == 0)
+	{
+		const int32 NumComponents = FMath::Max(1, PoolSize);
+		Components.Reserve(NumComponents);
+		for (int32 i = 0; i < NumComponents; i++)
+		{
+			Components.Add(CreatePooledEmitter());
+		}
+		UseTimes.Init(0.0f, NumComponents);
+	}
+
+	UParticleSystemComponent* PSC = AcquireEmitter(Components, UseTimes);
+
+	if (PSC->Template != FX)
+	{
+		PSC->SetTemplate(FX);
+	}
+
+	const FVector ShootDir = (EndPoint - Origin).GetSafeNormal();
+	PSC->SetWorldLocationAndRotation(Origin, bTracer ? ShootDir.Rotation() : FRotator::ZeroRotator);
+	if (TargetParam != NAME_None)
+	{
+		PSC->SetVectorParameter(TargetParam, EndPoint);
+	}
+	PSC->ActivateSystem(true);
+}
+
+
+bool UShooterFXManager::IsTrailVisible(const FVector& Origin, const FVector& EndPoint, float MaxDrawDistance) const
+{
+	APlayerController* PC = GetWorld()->GetFirstPlayerController();
+	if (PC == nullptr || PC->PlayerCameraManager == nullptr)
+	{
+		return true;
+	}
+
+	const FVector CamLoc = PC->PlayerCameraManager->GetCameraLocation();
+	const FVector CamDir = PC->PlayerCameraManager->GetCameraRotation().Vector();
+
+	/* Point of the trail closest to the line of sight is the one most likely on screen */
+	FVector TrailPoint;
+	FVector ViewPoint;
+	FMath::SegmentDistToSegmentSafe(Origin, EndPoint, CamLoc, CamLoc + CamDir * MaxDrawDistance, TrailPoint, ViewPoint);
+
+	const FVector ToTrail = TrailPoint - CamLoc;
+	const float DistSq = ToTrail.SizeSquared();
+	if (DistSq > FMath::Square(MaxDrawDistance))
+	{
+		return false;
+	}
+
+	/* Cone around the horizontal FOV with some margin for wide screens and the trail's width */
+	const float HalfAngle = FMath::DegreesToRadians(FMath::Min(PC->PlayerCameraManager->GetFOVAngle() * 0.5f + 15.0f, 89.0f));
+	const float Dot = FVector::DotProduct(ToTrail, CamDir);
+
+	return Dot > 0.0f && FMath::Square(Dot) >= FMath::Square(FMath::Cos(HalfAngle)) * DistSq;
+}
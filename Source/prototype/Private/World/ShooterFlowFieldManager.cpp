@@ -0,0 +1,432 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterFlowFieldManager.h"
+#include "NavigationSystem.h"
+#include "NavigationData.h"
+#include "AI/Navigation/NavAgentInterface.h"
+#include "Async/Async.h"
+#include "prototype/prototype.h"
+
+
+static int32 FlowFieldBuildBudget = 512;
+FAutoConsoleVariableRef CVARFlowFieldBuildBudget(
+	TEXT("COOP.FlowFieldBuildBudget"),
+	FlowFieldBuildBudget,
+	TEXT("Grid cells sampled from the navmesh per frame while the flow field grid is built"),
+	ECVF_Default);
+
+static const float FlowFieldCellSize = 100.0f;
+
+/* Larger maps get coarser cells */
+static const int32 MaxFlowFieldCells = 256 * 256;
+
+/* Targets tracked at the same time, one field each */
+static const int32 MaxFlowFieldTargets = 8;
+
+/* Seconds without a query before the field of a target is dropped */
+static const float FlowFieldIdleTime = 5.0f;
+
+/* Min seconds between two rebuilds of the same field */
+static const float FlowFieldRebuildInterval = 0.25f;
+
+/* Steps followed along the field when looking for a point at least MinDistance away */
+static const int32 MaxFlowLookahead = 8;
+
+static const uint8 NoFlowDirection = 0xFF;
+
+/* Even indices are orthogonal neighbours, the opposite of neighbour i is (i + 4) % 8 */
+static const FIntPoint FlowNeighbourOffsets[8] =
+{
+	FIntPoint(1, 0),
+	FIntPoint(1, 1),
+	FIntPoint(0, 1),
+	FIntPoint(-1, 1),
+	FIntPoint(-1, 0),
+	FIntPoint(-1, -1),
+	FIntPoint(0, -1),
+	FIntPoint(1, -1)
+};
+
+
+int32 FShooterFlowGrid::GetCellIndex(const FVector& Location) const
+{
+	const int32 X = FMath::FloorToInt((Location.X - Origin.X) / CellSize);
+	const int32 Y = FMath::FloorToInt((Location.Y - Origin.Y) / CellSize);
+	if (X < 0 || Y < 0 || X >= SizeX || Y >= SizeY)
+	{
+		return INDEX_NONE;
+	}
+
+	return Y * SizeX + X;
+}
+
+
+FVector FShooterFlowGrid::GetCellLocation(int32 CellIdx) const
+{
+	const int32 X = CellIdx % SizeX;
+	const int32 Y = CellIdx / SizeX;
+	return FVector(Origin.X + (X + 0.5f) * CellSize, Origin.Y + (Y + 0.5f) * CellSize, Heights[CellIdx]);
+}
+
+
+static FVector GetFlowTargetLocation(const AActor* Target)
+{
+	const INavAgentInterface* NavAgent = Cast<const INavAgentInterface>(Target);
+	return NavAgent ? NavAgent->GetNavAgentLocation() : Target->GetActorLocation();
+}
+
+
+UShooterFlowFieldManager::UShooterFlowFieldManager()
+{
+	BuildCursor = 0;
+	BuildZCenter = 0.0f;
+	BuildZExtent = 0.0f;
+	bGridRequested = false;
+}
+
+
+void UShooterFlowFieldManager::Deinitialize()
+{
+	/* Pending fields only reference the grid they were started with, nothing to wait for */
+	Targets.Empty();
+	PendingGrid.Reset();
+	Grid.Reset();
+	bGridRequested = false;
+
+	Super::Deinitialize();
+}
+
+
+void UShooterFlowFieldManager::Tick(float DeltaTime)
+{
+	if (bGridRequested && !Grid.IsValid())
+	{
+		BuildGridSlice();
+	}
+
+	UpdateTargets(GetWorld()->GetTimeSeconds());
+}
+
+
+ETickableTickType UShooterFlowFieldManager::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+
+bool UShooterFlowFieldManager::IsTickable() const
+{
+	return (bGridRequested && !Grid.IsValid()) || Targets.Num() > 0;
+}
+
+
+UWorld* UShooterFlowFieldManager::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+
+TStatId UShooterFlowFieldManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterFlowFieldManager, STATGROUP_Tickables);
+}
+
+
+bool UShooterFlowFieldManager::GetNextFlowPoint(AActor* Target, const FVector& Location, float MinDistance, FVector& OutPoint)
+{
+	if (!Target)
+	{
+		return false;
+	}
+
+	const float WorldTime = GetWorld()->GetTimeSeconds();
+
+	FShooterFlowFieldTarget* Entry = Targets.FindByPredicate([Target](const FShooterFlowFieldTarget& Other)
+	{
+		return Other.Target == Target;
+	});
+
+	if (!Entry)
+	{
+		if (Targets.Num() < MaxFlowFieldTargets)
+		{
+			FShooterFlowFieldTarget NewEntry;
+			NewEntry.Target = Target;
+			NewEntry.LastQueryTime = WorldTime;
+			NewEntry.LastBuildTime = -BIG_NUMBER;
+			Targets.Add(MoveTemp(NewEntry));
+
+			bGridRequested = true;
+		}
+
+		return false;
+	}
+
+	Entry->LastQueryTime = WorldTime;
+
+	if (!Grid.IsValid() || !Entry->Field.IsValid())
+	{
+		return false;
+	}
+
+	const FShooterFlowField& Field = *Entry->Field;
+
+	int32 CellIdx = Grid->GetCellIndex(Location);
+	if (CellIdx == INDEX_NONE || (CellIdx != Field.TargetCell && Field.Directions[CellIdx] == NoFlowDirection))
+	{
+		return false;
+	}
+
+	const float MinDistanceSq = FMath::Square(MinDistance);
+	for (int32 Step = 0; Step < MaxFlowLookahead; Step++)
+	{
+		const uint8 Direction = Field.Directions[CellIdx];
+		if (CellIdx == Field.TargetCell || Direction == NoFlowDirection)
+		{
+			/* Within the target cell, head straight for the target */
+			OutPoint = GetFlowTargetLocation(Target);
+			return true;
+		}
+
+		CellIdx += FlowNeighbourOffsets[Direction].Y * Grid->SizeX + FlowNeighbourOffsets[Direction].X;
+
+		OutPoint = Grid->GetCellLocation(CellIdx);
+		if (FVector::DistSquared2D(OutPoint, Location) > MinDistanceSq)
+		{
+			break;
+		}
+	}
+
+	return true;
+}
+
+
+bool UShooterFlowFieldManager::BuildGridSlice()
+{
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	ANavigationData* NavData = NavSys ? NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate) : nullptr;
+	if (!NavData)
+	{
+		return false;
+	}
+
+	if (!PendingGrid.IsValid())
+	{
+		const FBox Bounds = NavData->GetBounds();
+		if (!Bounds.IsValid)
+		{
+			return false;
+		}
+
+		const FVector Size = Bounds.GetSize();
+
+		float CellSize = FlowFieldCellSize;
+		const float NumCells = FMath::CeilToFloat(Size.X / CellSize) * FMath::CeilToFloat(Size.Y / CellSize);
+		if (NumCells > MaxFlowFieldCells)
+		{
+			CellSize *= FMath::Sqrt(NumCells / MaxFlowFieldCells);
+		}
+
+		PendingGrid = MakeShared<FShooterFlowGrid, ESPMode::ThreadSafe>();
+		PendingGrid->Origin = FVector2D(Bounds.Min);
+		PendingGrid->CellSize = CellSize;
+		PendingGrid->SizeX = FMath::Max(FMath::CeilToInt(Size.X / CellSize), 1);
+		PendingGrid->SizeY = FMath::Max(FMath::CeilToInt(Size.Y / CellSize), 1);
+
+		const int32 GridCells = PendingGrid->SizeX * PendingGrid->SizeY;
+		PendingGrid->Heights.SetNumZeroed(GridCells);
+		PendingGrid->Walkable.Init(false, GridCells);
+		PendingGrid->Links.SetNumZeroed(GridCells);
+
+		BuildZCenter = Bounds.GetCenter().Z;
+		BuildZExtent = Bounds.GetExtent().Z;
+		BuildCursor = 0;
+	}
+
+	FShooterFlowGrid& NewGrid = *PendingGrid;
+	const int32 NumCells = NewGrid.SizeX * NewGrid.SizeY;
+	const FVector ProjectExtent(NewGrid.CellSize * 0.5f, NewGrid.CellSize * 0.5f, BuildZExtent);
+
+	int32 Budget = FlowFieldBuildBudget;
+
+	/* Sample the navmesh height of each cell */
+	for (; BuildCursor < NumCells && Budget > 0; BuildCursor++, Budget--)
+	{
+		FVector CellCenter = NewGrid.GetCellLocation(BuildCursor);
+		CellCenter.Z = BuildZCenter;
+
+		FNavLocation NavLocation;
+		if (NavSys->ProjectPointToNavigation(CellCenter, NavLocation, ProjectExtent, NavData))
+		{
+			NewGrid.Walkable[BuildCursor] = true;
+			NewGrid.Heights[BuildCursor] = NavLocation.Location.Z;
+		}
+	}
+
+	/* Link walkable neighbours the navmesh can walk between in a straight line, half of the neighbours per cell */
+	FSharedConstNavQueryFilter QueryFilter = NavData->GetDefaultQueryFilter();
+	for (; BuildCursor >= NumCells && BuildCursor < NumCells * 2 && Budget > 0; BuildCursor++, Budget--)
+	{
+		const int32 CellIdx = BuildCursor - NumCells;
+		if (!NewGrid.Walkable[CellIdx])
+		{
+			continue;
+		}
+
+		const int32 X = CellIdx % NewGrid.SizeX;
+		const int32 Y = CellIdx / NewGrid.SizeX;
+		const FVector CellLocation = NewGrid.GetCellLocation(CellIdx);
+
+		for (int32 Neighbour = 0; Neighbour < 4; Neighbour++)
+		{
+			const int32 NX = X + FlowNeighbourOffsets[Neighbour].X;
+			const int32 NY = Y + FlowNeighbourOffsets[Neighbour].Y;
+			if (NX < 0 || NY < 0 || NX >= NewGrid.SizeX || NY >= NewGrid.SizeY)
+			{
+				continue;
+			}
+
+			const int32 NeighbourIdx = NY * NewGrid.SizeX + NX;
+			if (!NewGrid.Walkable[NeighbourIdx])
+			{
+				continue;
+			}
+
+			FVector HitLocation;
+			if (!NavData->Raycast(CellLocation, NewGrid.GetCellLocation(NeighbourIdx), HitLocation, QueryFilter))
+			{
+				NewGrid.Links[CellIdx] |= 1 << Neighbour;
+				NewGrid.Links[NeighbourIdx] |= 1 << (Neighbour + 4);
+			}
+		}
+	}
+
+	if (BuildCursor < NumCells * 2)
+	{
+		return false;
+	}
+
+	UE_LOG(LogGame, Log, TEXT("Flow field grid built, %d x %d cells of %.0f units"), NewGrid.SizeX, NewGrid.SizeY, NewGrid.CellSize);
+
+	Grid = PendingGrid;
+	PendingGrid.Reset();
+	return true;
+}
+
+
+void UShooterFlowFieldManager::UpdateTargets(float WorldTime)
+{
+	for (int32 i = Targets.Num() - 1; i >= 0; i--)
+	{
+		FShooterFlowFieldTarget& Entry = Targets[i];
+
+		AActor* Target = Entry.Target.Get();
+		if (!Target || WorldTime - Entry.LastQueryTime > FlowFieldIdleTime)
+		{
+			Targets.RemoveAtSwap(i);
+			continue;
+		}
+
+		if (Entry.PendingField.IsValid())
+		{
+			if (!Entry.PendingField.IsReady())
+			{
+				continue;
+			}
+
+			/* Swap in the new field, agents kept reading the previous one until now */
+			Entry.Field = Entry.PendingField.Get();
+			Entry.PendingField = TFuture<FShooterFlowFieldPtr>();
+		}
+
+		if (!Grid.IsValid() || WorldTime - Entry.LastBuildTime < FlowFieldRebuildInterval)
+		{
+			continue;
+		}
+
+		/* Only rebuild once the target entered another walkable cell, keep the last field while it is airborne */
+		const int32 TargetCell = Grid->GetCellIndex(GetFlowTargetLocation(Target));
+		if (TargetCell == INDEX_NONE || !Grid->Walkable[TargetCell] ||
+			(Entry.Field.IsValid() && Entry.Field->TargetCell == TargetCell))
+		{
+			continue;
+		}
+
+		FShooterFlowGridPtr FlowGrid = Grid;
+		Entry.PendingField = Async(EAsyncExecution::ThreadPool, [FlowGrid, TargetCell]()
+		{
+			return ComputeField(FlowGrid, TargetCell);
+		});
+		Entry.LastBuildTime = WorldTime;
+	}
+}
+
+
+FShooterFlowFieldPtr UShooterFlowFieldManager::ComputeField(FShooterFlowGridPtr FlowGrid, int32 TargetCell)
+{
+	const FShooterFlowGrid& FieldGrid = *FlowGrid;
+	const int32 NumCells = FieldGrid.SizeX * FieldGrid.SizeY;
+
+	TSharedRef<FShooterFlowField, ESPMode::ThreadSafe> Field = MakeShared<FShooterFlowField, ESPMode::ThreadSafe>();
+	Field->TargetCell = TargetCell;
+	Field->Directions.Init(NoFlowDirection, NumCells);
+
+	/* Dijkstra from the target outwards, 10 per orthogonal and 14 per diagonal step */
+	TArray<int32> Costs;
+	Costs.Init(MAX_int32, NumCells);
+	Costs[TargetCell] = 0;
+
+	typedef TPair<int32, int32> FOpenCell;
+	auto CostLess = [](const FOpenCell& A, const FOpenCell& B)
+	{
+		return A.Key < B.Key;
+	};
+
+	TArray<FOpenCell> Open;
+	Open.HeapPush(FOpenCell(0, TargetCell), CostLess);
+
+	while (Open.Num() > 0)
+	{
+		FOpenCell Current;
+		Open.HeapPop(Current, CostLess, false);
+
+		const int32 CellIdx = Current.Value;
+		if (Current.Key > Costs[CellIdx])
+		{
+			continue;
+		}
+
+		const uint8 Links = FieldGrid.Links[CellIdx];
+		for (int32 Neighbour = 0; Neighbour < 8; Neighbour++)
+		{
+			if ((Links & (1 << Neighbour)) == 0)
+			{
+				continue;
+			}
+
+			const bool bDiagonal = (Neighbour & 1) != 0;
+			if (bDiagonal)
+			{
+				/* No corner cutting, both orthogonal steps have to be open */
+				const uint8 SideMask = (1 << (Neighbour - 1)) | (1 << ((Neighbour + 1) % 8));
+				if ((Links & SideMask) != SideMask)
+				{
+					continue;
+				}
+			}
+
+			const int32 NeighbourIdx = CellIdx + FlowNeighbourOffsets[Neighbour].Y * FieldGrid.SizeX + FlowNeighbourOffsets[Neighbour].X;
+			const int32 NewCost = Current.Key + (bDiagonal ? 14 : 10);
+			if (NewCost < Costs[NeighbourIdx])
+			{
+				Costs[NeighbourIdx] = NewCost;
+				/* Step back towards the cell we came from */
+				Field->Directions[NeighbourIdx] = (Neighbour + 4) % 8;
+				Open.HeapPush(FOpenCell(NewCost, NeighbourIdx), CostLess);
+			}
+		}
+	}
+
+	return Field;
+}
@@ -13,17 +13,22 @@
 #include "AI/ShooterZombieCharacter.h"
 #include "AI/ShooterAICharacter.h"
 #include "World/ShooterPlayerStart.h"
+#include "World/ShooterPawnRegistry.h"
 #include "Mutators/ShooterMutator.h"
 #include "ShooterWeapon.h"
 #include "TimerManager.h"
 #include "Engine/Engine.h"
-#include "Kismet/GameplayStatics.h"
 #include "EngineUtils.h"
 #include "Components/CapsuleComponent.h"
 #include "Engine/LevelScriptActor.h"
+#include "Misc/MemStack.h"
 #include "../prototype.h"
 
 
+/* Prewarm ticks without a spawn location before the rest of the pools are left to fill on demand */
+static const int32 MaxBotPoolPrewarmFailures = 10;
+
+
 AShooterGameMode::AShooterGameMode()
 {
 	/* Assign the class types used by this gamemode */
@@ -54,6 +59,13 @@ AShooterGameMode::AShooterGameMode()
 	PlayerTeamNum = 1;
 
 	MaxPawnsInZone = 20;
+
+	BotPoolSize = 8;
+	NumBotPoolPrewarmFailures = 0;
+	SpawnLatencyCycles = 0;
+	MaxSpawnLatencyCycles = 0;
+	NumBotsSpawned = 0;
+	NumBotsReused = 0;
 }
 
 
@@ -64,7 +76,7 @@ void AShooterGameMode::InitGameState()
 	AShooterGameState* MyGameState = Cast<AShooterGameState>(GameState);
 	if (MyGameState)
 	{
-		MyGameState->ElapsedGameSeconds = TimeOfSecondStart;
+		MyGameState->SetTimeOfSecond(TimeOfSecondStart);
 	}
 }
 
@@ -79,6 +91,30 @@ void AShooterGameMode::PreInitializeComponents()
 }
 
 
+void AShooterGameMode::HandleMatchHasStarted()
+{
+	Super::HandleMatchHasStarted();
+
+	AShooterGameState* MyGameState = Cast<AShooterGameState>(GameState);
+	if (MyGameState)
+	{
+		MyGameState->StartMatchClock();
+	}
+}
+
+
+void AShooterGameMode::HandleMatchHasEnded()
+{
+	Super::HandleMatchHasEnded();
+
+	AShooterGameState* MyGameState = Cast<AShooterGameState>(GameState);
+	if (MyGameState)
+	{
+		MyGameState->StopMatchClock();
+	}
+}
+
+
 void AShooterGameMode::StartMatch()
 {
 	if (!HasMatchStarted())
@@ -102,15 +138,12 @@ void AShooterGameMode::DefaultTimer()
 		}
 	}
 
-	/* Only increment time of day while game is active */
+	/* Time of day runs on the game state's clock while the match is in progress, see HandleMatchHasStarted */
 	if (IsMatchInProgress())
 	{
 		AShooterGameState* MyGameState = Cast<AShooterGameState>(GameState);
 		if (MyGameState)
 		{
-			/* Increment our time of day */
-			MyGameState->ElapsedGameSeconds += MyGameState->GetTimeOfSecondIncrement();
-
 			///* Determine our state */
 			//MyGameState->GetAndUpdateIsNight();
 
@@ -210,27 +243,48 @@ bool AShooterGameMode::ShouldSpawnAtStartSpot(AController* Player)
 
 AActor* AShooterGameMode::ChoosePlayerStart_Implementation(AController* Player)
 {
-	TArray<APlayerStart*> PreferredSpawns;
-	TArray<APlayerStart*> FallbackSpawns;
+	/* Scratch arrays live on the frame allocator, released when Mark goes out of scope */
+	FMemMark Mark(FMemStack::Get());
+	TArray<const FShooterSpawnPoint*, TMemStackAllocator<>> PreferredSpawns;
+	TArray<const FShooterSpawnPoint*, TMemStackAllocator<>> FallbackSpawns;
 
-	/* Get all playerstart objects in level */
-	TArray<AActor*> PlayerStarts;
-	UGameplayStatics::GetAllActorsOfClass(this, APlayerStart::StaticClass(), PlayerStarts);
+	const bool bHasPlayerState = Player && Player->PlayerState;
+	const bool bIsHumanPlayer = bHasPlayerState && !Player->PlayerState->IsABot();
 
-	/* Split the player starts into two arrays for preferred and fallback spawns */
-	for (int32 i = 0; i < PlayerStarts.Num(); i++)
+	/* Player only spawns are preferred by humans unless occupied, bots can't use them */
+	if (bIsHumanPlayer || !bHasPlayerState)
 	{
-		APlayerStart* TestStart = Cast<APlayerStart>(PlayerStarts[i]);
-
-		if (TestStart && IsSpawnpointAllowed(TestStart, Player))
+		for (const FShooterSpawnPoint& SpawnPoint : PlayerOnlySpawnPoints)
 		{
-			if (IsSpawnpointPreferred(TestStart, Player))
+			if (SpawnPoint.PlayerStart)
 			{
-				PreferredSpawns.Add(TestStart);
+				if (bIsHumanPlayer && !IsSpawnPointOccupied(SpawnPoint))
+				{
+					PreferredSpawns.Add(&SpawnPoint);
+				}
+				else
+				{
+					FallbackSpawns.Add(&SpawnPoint);
+				}
 			}
-			else
+		}
+	}
+
+	for (const FShooterSpawnPoint& SpawnPoint : SharedSpawnPoints)
+	{
+		if (SpawnPoint.PlayerStart)
+		{
+			FallbackSpawns.Add(&SpawnPoint);
+		}
+	}
+
+	if (!bHasPlayerState)
+	{
+		for (const FShooterSpawnPoint& SpawnPoint : RestrictedSpawnPoints)
+		{
+			if (SpawnPoint.PlayerStart)
 			{
-				FallbackSpawns.Add(TestStart);
+				FallbackSpawns.Add(&SpawnPoint);
 			}
 		}
 	}
@@ -239,11 +293,11 @@ AActor* AShooterGameMode::ChoosePlayerStart_Implementation(AController* Player)
 	APlayerStart* BestStart = nullptr;
 	if (PreferredSpawns.Num() > 0)
 	{
-		BestStart = PreferredSpawns[FMath::RandHelper(PreferredSpawns.Num())];
+		BestStart = PreferredSpawns[FMath::RandHelper(PreferredSpawns.Num())]->PlayerStart;
 	}
 	else if (FallbackSpawns.Num() > 0)
 	{
-		BestStart = FallbackSpawns[FMath::RandHelper(FallbackSpawns.Num())];
+		BestStart = FallbackSpawns[FMath::RandHelper(FallbackSpawns.Num())]->PlayerStart;
 	}
 
 	/* If we failed to find any (so BestStart is nullptr) fall back to the base code */
@@ -251,56 +305,56 @@ AActor* AShooterGameMode::ChoosePlayerStart_Implementation(AController* Player)
 }
 
 
-bool AShooterGameMode::IsSpawnpointAllowed(APlayerStart* SpawnPoint, AController* Controller)
+void AShooterGameMode::BuildSpawnPointIndex()
 {
-	if (Controller == nullptr || Controller->PlayerState == nullptr)
-		return true;
+	PlayerOnlySpawnPoints.Reset();
+	SharedSpawnPoints.Reset();
+	RestrictedSpawnPoints.Reset();
 
-	/* Check for extended playerstart class */
-	AShooterPlayerStart* MyPlayerStart = Cast<AShooterPlayerStart>(SpawnPoint);
-	if (MyPlayerStart)
+	for (TActorIterator<APlayerStart> It(GetWorld()); It; ++It)
 	{
-		return MyPlayerStart->GetIsPlayerOnly() && !Controller->PlayerState->IsABot();
-	}
-
-	/* Cast failed, Anyone can spawn at the base playerstart class */
-	return true;
-}
+		APlayerStart* PlayerStart = *It;
+		if (PlayerStart->IsPendingKill())
+		{
+			continue;
+		}
 
+		FShooterSpawnPoint SpawnPoint;
+		SpawnPoint.PlayerStart = PlayerStart;
+		SpawnPoint.Location = PlayerStart->GetActorLocation();
 
-bool AShooterGameMode::IsSpawnpointPreferred(APlayerStart* SpawnPoint, AController* Controller)
-{
-	if (SpawnPoint)
-	{
-		/* Iterate all pawns to check for collision overlaps with the spawn point */
-		const FVector SpawnLocation = SpawnPoint->GetActorLocation();
-		for (TActorIterator<APawn> It(GetWorld()); It; ++It)
+		UCapsuleComponent* SpawnCapsule = PlayerStart->GetCapsuleComponent();
+		if (SpawnCapsule)
 		{
-			ACharacter* OtherPawn = Cast<ACharacter>(*It);
-			if (OtherPawn)
-			{
-				const float CombinedHeight = (SpawnPoint->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() +
-					OtherPawn->GetCapsuleComponent()->GetScaledCapsuleHalfHeight()) * 2.0f;
-				const float CombinedWidth = SpawnPoint->GetCapsuleComponent()->GetScaledCapsuleRadius() + OtherPawn->
-					GetCapsuleComponent()->GetScaledCapsuleRadius();
-				const FVector OtherLocation = OtherPawn->GetActorLocation();
-
-				// Check if player overlaps the playerstart
-				if (FMath::Abs(SpawnLocation.Z - OtherLocation.Z) < CombinedHeight && (SpawnLocation - OtherLocation).
-					Size2D() < CombinedWidth)
-				{
-					return false;
-				}
-			}
+			SpawnPoint.Radius = SpawnCapsule->GetScaledCapsuleRadius();
+			SpawnPoint.HalfHeight = SpawnCapsule->GetScaledCapsuleHalfHeight();
 		}
 
-		/* Check if spawnpoint is exclusive to players */
-		AShooterPlayerStart* MyPlayerStart = Cast<AShooterPlayerStart>(SpawnPoint);
-		if (MyPlayerStart)
+		/* Check for extended playerstart class, anyone can spawn at the base playerstart class */
+		AShooterPlayerStart* MyPlayerStart = Cast<AShooterPlayerStart>(PlayerStart);
+		if (MyPlayerStart == nullptr)
+		{
+			SharedSpawnPoints.Add(SpawnPoint);
+		}
+		else if (MyPlayerStart->GetIsPlayerOnly())
+		{
+			PlayerOnlySpawnPoints.Add(SpawnPoint);
+		}
+		else
 		{
-			return MyPlayerStart->GetIsPlayerOnly() && !Controller->PlayerState->IsABot();
+			RestrictedSpawnPoints.Add(SpawnPoint);
 		}
 	}
+}
+
+
+bool AShooterGameMode::IsSpawnPointOccupied(const FShooterSpawnPoint& SpawnPoint) const
+{
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (PawnRegistry)
+	{
+		return PawnRegistry->IsCapsuleOverlappingPawn(SpawnPoint.Location, SpawnPoint.Radius, SpawnPoint.HalfHeight);
+	}
 
 	return false;
 }
@@ -317,6 +371,12 @@ void AShooterGameMode::SpawnNewBot()
 		return;
 	}
 
+	SpawnBotAt(SpawnTransform);
+}
+
+
+APawn* AShooterGameMode::SpawnBotAt(const FTransform& SpawnTransform)
+{
 	float ProbabilitySubtraction = 1; // How much to reduce the probability of each iteration
 	const float RandomNum = FMath::FRandRange(0.0f, 1.0f); // A random float from 0 to 1
 
@@ -326,12 +386,149 @@ void AShooterGameMode::SpawnNewBot()
 
 		if (RandomNum >= ProbabilitySubtraction) // Check if the random number is bigger or equal than the subtraction, if it is then that is your item
 		{
-			
-			GetWorld()->SpawnActor<APawn>(BotPawnInfos[BotIndex].BotPawnClass, SpawnTransform);
+			const uint32 StartCycles = FPlatformTime::Cycles();
+
+			APawn* NewBot = SpawnBotFromPool(BotPawnInfos[BotIndex].BotPawnClass, SpawnTransform);
+
+			const uint32 SpawnCycles = FPlatformTime::Cycles() - StartCycles;
+			SpawnLatencyCycles += SpawnCycles;
+			MaxSpawnLatencyCycles = FMath::Max(MaxSpawnLatencyCycles, SpawnCycles);
+			NumBotsSpawned++;
+
+			return NewBot;
+		}
+	}
+
+	return nullptr;
+}
+
+
+APawn* AShooterGameMode::SpawnBotFromPool(TSubclassOf<APawn> BotPawnClass, const FTransform& SpawnTransform)
+{
+	FShooterBotPool* Pool = BotPools.Find(BotPawnClass);
+	if (Pool)
+	{
+		while (Pool->ParkedBots.Num() > 0)
+		{
+			AShooterBaseCharacter* Bot = Pool->ParkedBots.Pop(false);
+			if (Bot && !Bot->IsPendingKill())
+			{
+				Bot->ResetFromPool(SpawnTransform);
+				NumBotsReused++;
+				return Bot;
+			}
+		}
+	}
+
+	APawn* NewPawn = GetWorld()->SpawnActor<APawn>(BotPawnClass, SpawnTransform);
+
+	/* Bots spawned past the prewarm still join the pool, it grows to the largest wave */
+	AShooterBaseCharacter* NewBot = Cast<AShooterBaseCharacter>(NewPawn);
+	if (NewBot && BotPoolSize > 0)
+	{
+		NewBot->SetPooled(true);
+		BotPools.FindOrAdd(BotPawnClass).NumCreated++;
+	}
+
+	return NewPawn;
+}
+
+
+void AShooterGameMode::ReturnBotToPool(AShooterBaseCharacter* Bot)
+{
+	if (Bot == nullptr || !Bot->IsPooled())
+	{
+		return;
+	}
+
+	Bot->ParkInPool();
+	BotPools.FindOrAdd(Bot->GetClass()).ParkedBots.Add(Bot);
+}
+
+
+void AShooterGameMode::StartBotPoolPrewarm(float Duration)
+{
+	int32 NumToCreate = 0;
+	for (const FBotPawnInfo& Info : BotPawnInfos)
+	{
+		if (Info.BotPawnClass && Info.BotPawnClass->IsChildOf(AShooterBaseCharacter::StaticClass()))
+		{
+			NumToCreate += BotPoolSize;
+		}
+	}
+
+	if (NumToCreate > 0)
+	{
+		/* Spread the spawn cost so the pre-game countdown stays smooth */
+		const float Interval = FMath::Max(Duration / (NumToCreate + 1), 0.05f);
+		NumBotPoolPrewarmFailures = 0;
+		GetWorldTimerManager().SetTimer(TimerHandle_BotPoolPrewarm, this, &AShooterGameMode::PrewarmNextBot, Interval, true);
+	}
+}
+
+
+void AShooterGameMode::PrewarmNextBot()
+{
+	for (const FBotPawnInfo& Info : BotPawnInfos)
+	{
+		if (Info.BotPawnClass == nullptr || !Info.BotPawnClass->IsChildOf(AShooterBaseCharacter::StaticClass()))
+		{
+			continue;
+		}
+
+		FShooterBotPool& Pool = BotPools.FindOrAdd(Info.BotPawnClass);
+		if (Pool.NumCreated >= BotPoolSize)
+		{
+			continue;
+		}
+
+		/* Try again next tick, same as SpawnNewBot this fails until Blueprint implements it */
+		FTransform SpawnTransform;
+		if (!FindBotSpawnTransform(SpawnTransform))
+		{
+			if (++NumBotPoolPrewarmFailures >= MaxBotPoolPrewarmFailures)
+			{
+				UE_LOG(LogGame, Warning, TEXT("Failed to find bot spawn transform for PrewarmNextBot, bot pools fill on demand."));
+				GetWorldTimerManager().ClearTimer(TimerHandle_BotPoolPrewarm);
+			}
+			return;
+		}
+
+		NumBotPoolPrewarmFailures = 0;
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
 
-			break; 
+		AShooterBaseCharacter* NewBot = GetWorld()->SpawnActor<AShooterBaseCharacter>(Info.BotPawnClass, SpawnTransform, SpawnParams);
+		Pool.NumCreated++;
+
+		if (NewBot)
+		{
+			NewBot->SetPooled(true);
+			NewBot->ParkInPool();
+			Pool.ParkedBots.Add(NewBot);
 		}
+
+		return;
 	}
+
+	/* All pools are full */
+	GetWorldTimerManager().ClearTimer(TimerHandle_BotPoolPrewarm);
+}
+
+
+void AShooterGameMode::ReportBotSpawnLatency(int32 WaveNumber)
+{
+	if (NumBotsSpawned > 0)
+	{
+		UE_LOG(LogGame, Log, TEXT("Wave %d: spawned %d bots (%d from pool), avg %.3f ms, max %.3f ms"), WaveNumber, NumBotsSpawned,
+			NumBotsReused, FPlatformTime::ToMilliseconds(SpawnLatencyCycles) / NumBotsSpawned, FPlatformTime::ToMilliseconds(MaxSpawnLatencyCycles));
+	}
+
+	SpawnLatencyCycles = 0;
+	MaxSpawnLatencyCycles = 0;
+	NumBotsSpawned = 0;
+	NumBotsReused = 0;
 }
 
 /* Used by RestartPlayer() to determine the pawn to create and possess when a bot or player spawns */
@@ -360,26 +557,34 @@ bool AShooterGameMode::CanSpectate_Implementation(APlayerController* Viewer, APl
 
 void AShooterGameMode::PassifyAllBots()
 {
-	for (TActorIterator<APawn> It(GetWorld()); It; ++It)
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (PawnRegistry)
 	{
-		AShooterZombieCharacter* AIPawn = Cast<AShooterZombieCharacter>(*It);
-		if (AIPawn)
+		PawnRegistry->ForEachPawn(EShooterPawnKind::Bot, true, [](APawn* Pawn)
 		{
-			AIPawn->SetBotType(EBotBehaviorType::Passive);
-		}
+			AShooterZombieCharacter* AIPawn = Cast<AShooterZombieCharacter>(Pawn);
+			if (AIPawn)
+			{
+				AIPawn->SetBotType(EBotBehaviorType::Passive);
+			}
+		});
 	}
 }
 
 
 void AShooterGameMode::WakeAllBots()
 {
-	for (TActorIterator<APawn> It(GetWorld()); It; ++It)
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (PawnRegistry)
 	{
-		AShooterZombieCharacter* AIPawn = Cast<AShooterZombieCharacter>(*It);
-		if (AIPawn)
+		PawnRegistry->ForEachPawn(EShooterPawnKind::Bot, true, [](APawn* Pawn)
 		{
-			AIPawn->SetBotType(EBotBehaviorType::Patrolling);
-		}
+			AShooterZombieCharacter* AIPawn = Cast<AShooterZombieCharacter>(Pawn);
+			if (AIPawn)
+			{
+				AIPawn->SetBotType(EBotBehaviorType::Patrolling);
+			}
+		});
 	}
 }
 
@@ -387,13 +592,10 @@ void AShooterGameMode::WakeAllBots()
 void AShooterGameMode::SpawnBotHandler()
 {
 	AShooterGameState* MyGameState = Cast<AShooterGameState>(GameState);
-	if (MyGameState)
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (MyGameState && PawnRegistry)
 	{
-		int32 PawnsInWorld = 0;
-		for (TActorIterator<APawn> It(GetWorld()); It; ++It)
-		{
-			++PawnsInWorld;
-		}
+		const int32 PawnsInWorld = PawnRegistry->GetNumPawns();
 
 		/* Check number of available pawns (players included) */
 		if (PawnsInWorld < MaxPawnsInZone)
@@ -488,6 +690,9 @@ void AShooterGameMode::InitGame(const FString& MapName, const FString& Options,
 		}
 	}
 
+	/* Mutators had their chance to remove player starts, index what is left */
+	BuildSpawnPointIndex();
+
 	Super::InitGame(MapName, Options, ErrorMessage);
 }
 
@@ -6,6 +6,7 @@
 #include "GameFramework/PlayerState.h"
 #include "World/ShooterGameInstance.h"
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
 
 
 AShooterGameState::AShooterGameState()
@@ -17,39 +18,74 @@ AShooterGameState::AShooterGameState()
 
 void AShooterGameState::SetTimeOfSecond(float NewSeconds)
 {
-	ElapsedGameSeconds = NewSeconds;
+	if (HasAuthority())
+	{
+		MatchClock.StartGameSeconds = NewSeconds;
+		MatchClock.StartWorldTime = GetServerWorldTimeSeconds();
+		MARK_PROPERTY_DIRTY_FROM_NAME(AShooterGameState, MatchClock, this);
+	}
+}
+
+
+float AShooterGameState::GetElapsedGameSeconds() const
+{
+	return MatchClock.GetGameSeconds(GetServerWorldTimeSeconds());
+}
+
+
+int32 AShooterGameState::GetNextWaveRemainingTime() const
+{
+	return FMath::TruncToInt(GetNextWaveRemainingSeconds());
+}
+
+
+float AShooterGameState::GetNextWaveRemainingSeconds() const
+{
+	return WaveInfo.NextWaveStartTime - GetElapsedGameSeconds();
 }
 
 
-int32 AShooterGameState::GetNextWaveRemainingTime()
+void AShooterGameState::StartMatchClock()
 {
-	return NextWaveStartTime - ElapsedGameSeconds;
+	if (HasAuthority() && !MatchClock.bRunning)
+	{
+		MatchClock.StartWorldTime = GetServerWorldTimeSeconds();
+		MatchClock.TimeScale = TimeScale;
+		MatchClock.bRunning = true;
+		MARK_PROPERTY_DIRTY_FROM_NAME(AShooterGameState, MatchClock, this);
+	}
 }
 
-float AShooterGameState::GetTimeOfSecondIncrement() const
+
+void AShooterGameState::StopMatchClock()
 {
-	return (GetWorldSettings()->GetEffectiveTimeDilation() * TimeScale);
+	if (HasAuthority() && MatchClock.bRunning)
+	{
+		MatchClock.StartGameSeconds = GetElapsedGameSeconds();
+		MatchClock.bRunning = false;
+		MARK_PROPERTY_DIRTY_FROM_NAME(AShooterGameState, MatchClock, this);
+	}
 }
 
 
-int32 AShooterGameState::GetElapsedMinutes()
+int32 AShooterGameState::GetElapsedMinutes() const
 {
 	const float SecondsInMinute = 60;
-	const float ElapsedMinutes = ElapsedGameSeconds / SecondsInMinute;
+	const float ElapsedMinutes = GetElapsedGameSeconds() / SecondsInMinute;
 	return FMath::FloorToInt(ElapsedMinutes);
 }
 
 
-int32 AShooterGameState::GetElapsedFullMinutesInSeconds()
+int32 AShooterGameState::GetElapsedFullMinutesInSeconds() const
 {
 	const int32 SecondsInMinute = 60;
 	return GetElapsedMinutes() * SecondsInMinute;
 }
 
 
-int32 AShooterGameState::GetElapsedSecondsCurrentMinute()
+int32 AShooterGameState::GetElapsedSecondsCurrentMinute() const
 {
-	return ElapsedGameSeconds - GetElapsedFullMinutesInSeconds();
+	return FMath::FloorToInt(GetElapsedGameSeconds()) - GetElapsedFullMinutesInSeconds();
 }
 
 
@@ -118,12 +154,38 @@ int32 AShooterGameState::GetTotalScore()
 void AShooterGameState::AddScore(int32 Score)
 {
 	TotalScore += Score;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AShooterGameState, TotalScore, this);
+}
+
+
+void AShooterGameState::SetVIPHealth(int32 NewHealth)
+{
+	VIPHealth = NewHealth;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AShooterGameState, VIPHealth, this);
+}
+
+
+void AShooterGameState::SetPlayerRespawnCount(int32 NewCount)
+{
+	PlayerRespawnCount = NewCount;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AShooterGameState, PlayerRespawnCount, this);
 }
 
 
-void AShooterGameState::OnRep_WaveState(EWaveState OldState)
+void AShooterGameState::SetGameIsWin(bool bNewIsWin)
 {
-	WaveStateChanged(WaveState, OldState);
+	GameIsWin = bNewIsWin;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AShooterGameState, GameIsWin, this);
+}
+
+
+void AShooterGameState::OnRep_WaveInfo(const FShooterWaveInfo& OldInfo)
+{
+	/* Counters change more often than the state, only state changes produce HUD messages */
+	if (WaveInfo.State != OldInfo.State)
+	{
+		WaveStateChanged(WaveInfo.State, OldInfo.State);
+	}
 }
 
 void AShooterGameState::WaveStateChanged(EWaveState NewState, EWaveState OldState)
@@ -151,31 +213,74 @@ void AShooterGameState::WaveStateChanged(EWaveState NewState, EWaveState OldStat
 
 void AShooterGameState::SetWaveCount(int32 NewWaveCount)
 {
-	WaveCount = NewWaveCount;
+	WaveInfo.WaveCount = NewWaveCount;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AShooterGameState, WaveInfo, this);
 }
 
 void AShooterGameState::SetWaveState(EWaveState NewState)
 {
 	if (HasAuthority())
 	{
-		EWaveState OldState = WaveState;
+		const FShooterWaveInfo OldInfo = WaveInfo;
 
-		WaveState = NewState;
+		WaveInfo.State = NewState;
+		MARK_PROPERTY_DIRTY_FROM_NAME(AShooterGameState, WaveInfo, this);
 		// Call on server
-		OnRep_WaveState(OldState);
+		OnRep_WaveInfo(OldInfo);
+	}
+}
+
+
+void AShooterGameState::SetNextWaveStartTime(int32 NewStartTime)
+{
+	WaveInfo.NextWaveStartTime = NewStartTime;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AShooterGameState, WaveInfo, this);
+}
+
+
+void AShooterGameState::SetNumBotsAlive(int32 NewNumBotsAlive)
+{
+	WaveInfo.NumBotsAlive = NewNumBotsAlive;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AShooterGameState, WaveInfo, this);
+}
+
+
+bool FShooterWaveInfo::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 StateValue = (uint32)State;
+	Ar.SerializeInt(StateValue, 8);
+
+	uint32 PackedWaveCount = FMath::Max(WaveCount, 0);
+	uint32 PackedStartTime = FMath::Max(NextWaveStartTime, 0);
+	uint32 PackedBotsAlive = FMath::Max(NumBotsAlive, 0);
+	Ar.SerializeIntPacked(PackedWaveCount);
+	Ar.SerializeIntPacked(PackedStartTime);
+	Ar.SerializeIntPacked(PackedBotsAlive);
+
+	if (Ar.IsLoading())
+	{
+		State = (EWaveState)StateValue;
+		WaveCount = PackedWaveCount;
+		NextWaveStartTime = PackedStartTime;
+		NumBotsAlive = PackedBotsAlive;
 	}
+
+	bOutSuccess = true;
+	return true;
 }
 
 void AShooterGameState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(AShooterGameState, ElapsedGameSeconds);
-	DOREPLIFETIME(AShooterGameState, TotalScore);
-	DOREPLIFETIME(AShooterGameState, WaveState);
-	DOREPLIFETIME(AShooterGameState, WaveCount);
-	DOREPLIFETIME(AShooterGameState, NextWaveStartTime);
-	DOREPLIFETIME(AShooterGameState, GameIsWin);
-	DOREPLIFETIME(AShooterGameState, VIPHealth);
-	DOREPLIFETIME(AShooterGameState, PlayerRespawnCount);
+	/* Push based, only compared after being marked dirty */
+	FDoRepLifetimeParams SharedParams;
+	SharedParams.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(AShooterGameState, MatchClock, SharedParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AShooterGameState, TotalScore, SharedParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AShooterGameState, WaveInfo, SharedParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AShooterGameState, GameIsWin, SharedParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AShooterGameState, VIPHealth, SharedParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AShooterGameState, PlayerRespawnCount, SharedParams);
 }
@@ -0,0 +1,287 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterPathCache.h"
+#include "NavigationSystem.h"
+#include "AI/Navigation/NavAgentInterface.h"
+
+
+static int32 PathQueriesPerFrame = 2;
+FAutoConsoleVariableRef CVARPathQueriesPerFrame(
+	TEXT("COOP.PathQueriesPerFrame"),
+	PathQueriesPerFrame,
+	TEXT("Number of async path queries started per frame"),
+	ECVF_Default);
+
+static float PathCacheMaxAge = 5.0f;
+FAutoConsoleVariableRef CVARPathCacheMaxAge(
+	TEXT("COOP.PathCacheMaxAge"),
+	PathCacheMaxAge,
+	TEXT("Seconds a cached path is shared before it is queried again"),
+	ECVF_Default);
+
+/* Max distance of a bot from a cached path to follow it */
+static const float PathJoinRadius = 250.0f;
+
+/* Goal movement after which a cached path is considered stale */
+static const float RepathGoalDistance = 300.0f;
+
+/* Paths kept per goal, bots coming from different directions need their own */
+static const int32 MaxPathsPerGoal = 4;
+
+
+void UShooterPathCache::Deinitialize()
+{
+	Requests.Empty();
+	Paths.Empty();
+
+	Super::Deinitialize();
+}
+
+
+void UShooterPathCache::Tick(float DeltaTime)
+{
+	DispatchRequests();
+}
+
+
+ETickableTickType UShooterPathCache::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+
+bool UShooterPathCache::IsTickable() const
+{
+	return Requests.Num() > 0;
+}
+
+
+UWorld* UShooterPathCache::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+
+TStatId UShooterPathCache::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterPathCache, STATGROUP_Tickables);
+}
+
+
+bool UShooterPathCache::FindNextPathPoint(const FVector& Location, AActor* Goal, float AcceptRadius, FVector& OutPoint)
+{
+	if (!Goal)
+	{
+		return false;
+	}
+
+	const float WorldTime = GetWorld()->GetTimeSeconds();
+	const FVector GoalLocation = GetGoalLocation(Goal);
+
+	TArray<FShooterSharedPath>* GoalPaths = Paths.Find(Goal);
+	if (GoalPaths)
+	{
+		for (int32 i = GoalPaths->Num() - 1; i >= 0; i--)
+		{
+			const FShooterSharedPath& Path = (*GoalPaths)[i];
+			if (IsPathStale(Path, GoalLocation, WorldTime))
+			{
+				GoalPaths->RemoveAtSwap(i);
+				continue;
+			}
+
+			int32 PointIdx = FindJoinIndex(Path, Location);
+			if (PointIdx == INDEX_NONE)
+			{
+				continue;
+			}
+
+			/* Skip the points we already reached */
+			const float AcceptRadiusSq = FMath::Square(AcceptRadius);
+			while (PointIdx < Path.Points.Num() - 1 && FVector::DistSquared(Path.Points[PointIdx], Location) <= AcceptRadiusSq)
+			{
+				PointIdx++;
+			}
+
+			OutPoint = Path.Points[PointIdx];
+			return true;
+		}
+
+		if (GoalPaths->Num() == 0)
+		{
+			Paths.Remove(Goal);
+		}
+	}
+
+	QueueRequest(Goal, Location);
+	return false;
+}
+
+
+int32 UShooterPathCache::FindJoinIndex(const FShooterSharedPath& Path, const FVector& Location)
+{
+	const float JoinRadiusSq = FMath::Square(PathJoinRadius);
+
+	/* Failed queries are cached as a single point so the bot stays put until the path goes stale */
+	if (Path.Points.Num() == 1)
+	{
+		return FVector::DistSquared(Path.Points[0], Location) <= JoinRadiusSq ? 0 : INDEX_NONE;
+	}
+
+	int32 BestIdx = INDEX_NONE;
+	float BestDistSq = JoinRadiusSq;
+	for (int32 i = 0; i < Path.Points.Num() - 1; i++)
+	{
+		const FVector ClosestPoint = FMath::ClosestPointOnSegment(Location, Path.Points[i], Path.Points[i + 1]);
+		const float DistSq = FVector::DistSquared(ClosestPoint, Location);
+		if (DistSq <= BestDistSq)
+		{
+			BestDistSq = DistSq;
+			BestIdx = i + 1;
+		}
+	}
+
+	return BestIdx;
+}
+
+
+FVector UShooterPathCache::GetGoalLocation(const AActor* Goal)
+{
+	const INavAgentInterface* NavAgent = Cast<const INavAgentInterface>(Goal);
+	return NavAgent ? NavAgent->GetNavAgentLocation() : Goal->GetActorLocation();
+}
+
+
+bool UShooterPathCache::IsPathStale(const FShooterSharedPath& Path, const FVector& GoalLocation, float WorldTime) const
+{
+	return WorldTime - Path.TimeStamp > PathCacheMaxAge ||
+		FVector::DistSquared(Path.GoalLocation, GoalLocation) > FMath::Square(RepathGoalDistance);
+}
+
+
+void UShooterPathCache::QueueRequest(AActor* Goal, const FVector& Start)
+{
+	/* Wait for a pending query that starts close enough for us to join */
+	const float JoinRadiusSq = FMath::Square(PathJoinRadius);
+	for (const FShooterPathRequest& Request : Requests)
+	{
+		if (Request.Goal == Goal && FVector::DistSquared(Request.Start, Start) <= JoinRadiusSq)
+		{
+			return;
+		}
+	}
+
+	FShooterPathRequest Request;
+	Request.Goal = Goal;
+	Request.Start = Start;
+	Request.QueryId = INVALID_NAVQUERYID;
+	Requests.Add(Request);
+}
+
+
+void UShooterPathCache::DispatchRequests()
+{
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	ANavigationData* NavData = NavSys ? NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate) : nullptr;
+
+	int32 NumDispatched = 0;
+	for (int32 i = 0; i < Requests.Num() && NumDispatched < PathQueriesPerFrame; i++)
+	{
+		FShooterPathRequest& Request = Requests[i];
+		if (Request.QueryId != INVALID_NAVQUERYID)
+		{
+			continue;
+		}
+
+		AActor* Goal = Request.Goal.Get();
+		if (!Goal || !NavData)
+		{
+			Requests.RemoveAt(i--);
+			continue;
+		}
+
+		FPathFindingQuery Query(this, *NavData, Request.Start, GetGoalLocation(Goal), NavData->GetDefaultQueryFilter());
+		Query.SetAllowPartialPaths(true);
+
+		Request.QueryId = NavSys->FindPathAsync(FNavAgentProperties::DefaultProperties, Query,
+			FNavPathQueryDelegate::CreateUObject(this, &UShooterPathCache::OnPathQueryFinished));
+
+		if (Request.QueryId == INVALID_NAVQUERYID)
+		{
+			Requests.RemoveAt(i--);
+			continue;
+		}
+
+		NumDispatched++;
+	}
+
+	/* Drop paths of goals that no longer exist */
+	for (auto It = Paths.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+
+void UShooterPathCache::OnPathQueryFinished(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path)
+{
+	const int32 RequestIdx = Requests.IndexOfByPredicate([QueryId](const FShooterPathRequest& Request)
+	{
+		return Request.QueryId == QueryId;
+	});
+
+	if (RequestIdx == INDEX_NONE)
+	{
+		return;
+	}
+
+	AActor* Goal = Requests[RequestIdx].Goal.Get();
+	const FVector Start = Requests[RequestIdx].Start;
+	Requests.RemoveAt(RequestIdx);
+
+	if (Goal)
+	{
+		AddPath(Goal, Start, Path, Result == ENavigationQueryResult::Success && Path.IsValid());
+	}
+}
+
+
+void UShooterPathCache::AddPath(AActor* Goal, const FVector& Start, FNavPathSharedPtr Path, bool bSuccess)
+{
+	FShooterSharedPath NewPath;
+	NewPath.GoalLocation = GetGoalLocation(Goal);
+	NewPath.TimeStamp = GetWorld()->GetTimeSeconds();
+
+	if (bSuccess)
+	{
+		for (const FNavPathPoint& PathPoint : Path->GetPathPoints())
+		{
+			NewPath.Points.Add(PathPoint.Location);
+		}
+	}
+
+	if (NewPath.Points.Num() == 0)
+	{
+		NewPath.Points.Add(Start);
+	}
+
+	TArray<FShooterSharedPath>& GoalPaths = Paths.FindOrAdd(Goal);
+	if (GoalPaths.Num() >= MaxPathsPerGoal)
+	{
+		int32 OldestIdx = 0;
+		for (int32 i = 1; i < GoalPaths.Num(); i++)
+		{
+			if (GoalPaths[i].TimeStamp < GoalPaths[OldestIdx].TimeStamp)
+			{
+				OldestIdx = i;
+			}
+		}
+		GoalPaths.RemoveAtSwap(OldestIdx);
+	}
+
+	GoalPaths.Add(MoveTemp(NewPath));
+}
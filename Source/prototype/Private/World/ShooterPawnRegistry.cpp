@@ -0,0 +1,322 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterPawnRegistry.h"
+#include "ShooterBaseCharacter.h"
+#include "AI/ShooterVIPCharacter.h"
+#include "AI/ShooterTrackerBot.h"
+#include "Components/ShooterHealthComponent.h"
+#include "ShooterPlayerState.h"
+
+
+UShooterPawnRegistry::UShooterPawnRegistry()
+{
+	FMemory::Memzero(Counts);
+}
+
+
+void UShooterPawnRegistry::Deinitialize()
+{
+	Buckets.Empty();
+	PawnSlots.Empty();
+	FMemory::Memzero(Counts);
+
+	OnAlivePawnCountChanged.Clear();
+
+	SpatialHash.Reset();
+	PawnHashIds.Empty();
+	HashIdToPawn.Empty();
+	FreeHashIds.Empty();
+
+	Super::Deinitialize();
+}
+
+
+void UShooterPawnRegistry::RegisterPawn(APawn* Pawn)
+{
+	if (Pawn == nullptr || PawnSlots.Contains(Pawn))
+	{
+		return;
+	}
+
+	const EShooterPawnKind Kind = GetPawnKind(Pawn, EShooterPawnKind::Bot);
+	const int32 Team = GetPawnTeam(Pawn);
+	const bool bAlive = IsPawnAlive(Pawn);
+
+	int32 OldAliveCounts[(int32)EShooterPawnKind::Num];
+	GetAliveCounts(OldAliveCounts);
+
+	AddToBucket(Pawn, FindOrAddBucket(Kind, Team, bAlive));
+	UpdateHashEntry(Pawn, Team, bAlive);
+
+	NotifyAliveCountChanges(OldAliveCounts);
+}
+
+
+void UShooterPawnRegistry::UnregisterPawn(APawn* Pawn)
+{
+	int32 OldAliveCounts[(int32)EShooterPawnKind::Num];
+	GetAliveCounts(OldAliveCounts);
+
+	FPawnSlot Slot;
+	if (PawnSlots.RemoveAndCopyValue(Pawn, Slot))
+	{
+		RemoveFromBucket(Slot);
+		RemoveHashEntry(Pawn);
+
+		NotifyAliveCountChanges(OldAliveCounts);
+	}
+}
+
+
+void UShooterPawnRegistry::UpdatePawn(APawn* Pawn)
+{
+	FPawnSlot* Slot = PawnSlots.Find(Pawn);
+	if (Slot == nullptr)
+	{
+		return;
+	}
+
+	const FShooterPawnBucket& OldBucket = Buckets[Slot->BucketIndex];
+	const EShooterPawnKind Kind = GetPawnKind(Pawn, OldBucket.Kind);
+	const int32 Team = GetPawnTeam(Pawn);
+	const bool bAlive = IsPawnAlive(Pawn);
+
+	if (Kind == OldBucket.Kind && Team == OldBucket.Team && bAlive == OldBucket.bAlive)
+	{
+		return;
+	}
+
+	/* Listeners only see the final counts, never the pawn being between buckets */
+	int32 OldAliveCounts[(int32)EShooterPawnKind::Num];
+	GetAliveCounts(OldAliveCounts);
+
+	const FPawnSlot OldSlot = *Slot;
+	PawnSlots.Remove(Pawn);
+	RemoveFromBucket(OldSlot);
+
+	AddToBucket(Pawn, FindOrAddBucket(Kind, Team, bAlive));
+	UpdateHashEntry(Pawn, Team, bAlive);
+
+	NotifyAliveCountChanges(OldAliveCounts);
+}
+
+
+APawn* UShooterPawnRegistry::GetFirstPawn(EShooterPawnKind Kind, bool bAlive) const
+{
+	for (const FShooterPawnBucket& Bucket : Buckets)
+	{
+		if (Bucket.Kind == Kind && Bucket.bAlive == bAlive && Bucket.Pawns.Num() > 0)
+		{
+			return Bucket.Pawns[0];
+		}
+	}
+
+	return nullptr;
+}
+
+
+int32 UShooterPawnRegistry::GetPawnTeam(const APawn* Pawn)
+{
+	UShooterHealthComponent* HealthComp = Pawn->FindComponentByClass<UShooterHealthComponent>();
+	if (HealthComp)
+	{
+		return HealthComp->TeamNum;
+	}
+
+	AShooterPlayerState* PS = Pawn->GetPlayerState<AShooterPlayerState>();
+	return PS ? PS->GetTeamNumber() : INDEX_NONE;
+}
+
+
+EShooterPawnKind UShooterPawnRegistry::GetPawnKind(const APawn* Pawn, EShooterPawnKind PreviousKind)
+{
+	if (Pawn->IsA<AShooterTrackerBot>())
+	{
+		return EShooterPawnKind::TrackerBot;
+	}
+
+	if (Pawn->IsA<AShooterVIPCharacter>())
+	{
+		return EShooterPawnKind::VIP;
+	}
+
+	if (Pawn->GetPlayerState() == nullptr)
+	{
+		return PreviousKind;
+	}
+
+	return Pawn->GetPlayerState()->IsABot() ? EShooterPawnKind::Bot : EShooterPawnKind::Player;
+}
+
+
+bool UShooterPawnRegistry::IsPawnAlive(const APawn* Pawn)
+{
+	const AShooterBaseCharacter* Character = Cast<AShooterBaseCharacter>(Pawn);
+	if (Character)
+	{
+		return Character->IsAlive();
+	}
+
+	const AShooterTrackerBot* TrackerBot = Cast<AShooterTrackerBot>(Pawn);
+	if (TrackerBot)
+	{
+		return !TrackerBot->IsExploded();
+	}
+
+	return !Pawn->IsPendingKill();
+}
+
+
+int32 UShooterPawnRegistry::FindOrAddBucket(EShooterPawnKind Kind, int32 Team, bool bAlive)
+{
+	for (int32 i = 0; i < Buckets.Num(); i++)
+	{
+		const FShooterPawnBucket& Bucket = Buckets[i];
+		if (Bucket.Kind == Kind && Bucket.Team == Team && Bucket.bAlive == bAlive)
+		{
+			return i;
+		}
+	}
+
+	/* Only a handful of teams exist, buckets are never removed */
+	FShooterPawnBucket& NewBucket = Buckets.AddDefaulted_GetRef();
+	NewBucket.Kind = Kind;
+	NewBucket.Team = Team;
+	NewBucket.bAlive = bAlive;
+
+	return Buckets.Num() - 1;
+}
+
+
+void UShooterPawnRegistry::AddToBucket(APawn* Pawn, int32 BucketIndex)
+{
+	FShooterPawnBucket& Bucket = Buckets[BucketIndex];
+
+	FPawnSlot Slot;
+	Slot.BucketIndex = BucketIndex;
+	Slot.Index = Bucket.Pawns.Add(Pawn);
+	PawnSlots.Add(Pawn, Slot);
+
+	Counts[(int32)Bucket.Kind][Bucket.bAlive ? 1 : 0]++;
+}
+
+
+void UShooterPawnRegistry::RemoveFromBucket(const FPawnSlot& Slot)
+{
+	FShooterPawnBucket& Bucket = Buckets[Slot.BucketIndex];
+
+	Bucket.Pawns.RemoveAtSwap(Slot.Index, 1, false);
+	if (Slot.Index < Bucket.Pawns.Num())
+	{
+		PawnSlots.FindChecked(Bucket.Pawns[Slot.Index]).Index = Slot.Index;
+	}
+
+	Counts[(int32)Bucket.Kind][Bucket.bAlive ? 1 : 0]--;
+}
+
+
+void UShooterPawnRegistry::UpdatePawnLocation(APawn* Pawn)
+{
+	const int32* HashId = PawnHashIds.Find(Pawn);
+	if (HashId)
+	{
+		SpatialHash.Move(*HashId, Pawn->GetActorLocation());
+	}
+}
+
+
+APawn* UShooterPawnRegistry::FindNearestPawn(const FVector& Center, float MaxRadius, int32 Team, EShooterTeamFilter Filter, float* OutDistSq) const
+{
+	int32 HashId;
+	if (SpatialHash.FindNearest(Center, MaxRadius, Team, Filter, 1, &HashId, OutDistSq) == 0)
+	{
+		return nullptr;
+	}
+
+	return HashIdToPawn[HashId];
+}
+
+
+int32 UShooterPawnRegistry::FindNearestPawns(const FVector& Center, float MaxRadius, int32 Team, EShooterTeamFilter Filter, int32 MaxResults, TArray<APawn*>& OutPawns) const
+{
+	TArray<int32, TInlineAllocator<16>> HashIds;
+	HashIds.AddUninitialized(FMath::Max(MaxResults, 0));
+
+	const int32 NumFound = SpatialHash.FindNearest(Center, MaxRadius, Team, Filter, MaxResults, HashIds.GetData());
+
+	OutPawns.Reset(NumFound);
+	for (int32 i = 0; i < NumFound; i++)
+	{
+		OutPawns.Add(HashIdToPawn[HashIds[i]]);
+	}
+
+	return NumFound;
+}
+
+
+void UShooterPawnRegistry::UpdateHashEntry(APawn* Pawn, int32 Team, bool bAlive)
+{
+	if (!bAlive)
+	{
+		RemoveHashEntry(Pawn);
+		return;
+	}
+
+	const int32* ExistingId = PawnHashIds.Find(Pawn);
+	if (ExistingId)
+	{
+		SpatialHash.SetTeam(*ExistingId, Team);
+		return;
+	}
+
+	int32 HashId;
+	if (FreeHashIds.Num() > 0)
+	{
+		HashId = FreeHashIds.Pop(false);
+		HashIdToPawn[HashId] = Pawn;
+	}
+	else
+	{
+		HashId = HashIdToPawn.Add(Pawn);
+	}
+
+	PawnHashIds.Add(Pawn, HashId);
+
+	float Radius, HalfHeight;
+	Pawn->GetSimpleCollisionCylinder(Radius, HalfHeight);
+	SpatialHash.Add(HashId, Pawn->GetActorLocation(), Team, Radius, HalfHeight);
+}
+
+
+void UShooterPawnRegistry::RemoveHashEntry(APawn* Pawn)
+{
+	int32 HashId;
+	if (PawnHashIds.RemoveAndCopyValue(Pawn, HashId))
+	{
+		SpatialHash.Remove(HashId);
+		HashIdToPawn[HashId] = nullptr;
+		FreeHashIds.Add(HashId);
+	}
+}
+
+
+void UShooterPawnRegistry::GetAliveCounts(int32* OutAliveCounts) const
+{
+	for (int32 KindIdx = 0; KindIdx < (int32)EShooterPawnKind::Num; KindIdx++)
+	{
+		OutAliveCounts[KindIdx] = Counts[KindIdx][1];
+	}
+}
+
+
+void UShooterPawnRegistry::NotifyAliveCountChanges(const int32* OldAliveCounts)
+{
+	for (int32 KindIdx = 0; KindIdx < (int32)EShooterPawnKind::Num; KindIdx++)
+	{
+		if (Counts[KindIdx][1] != OldAliveCounts[KindIdx])
+		{
+			OnAlivePawnCountChanged.Broadcast((EShooterPawnKind)KindIdx, Counts[KindIdx][1]);
+		}
+	}
+}
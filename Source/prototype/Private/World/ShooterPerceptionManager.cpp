@@ -0,0 +1,442 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterPerceptionManager.h"
+#include "World/ShooterPawnRegistry.h"
+#include "World/ShooterAISignificanceManager.h"
+#include "AI/ShooterZombieCharacter.h"
+#include "Components/PawnNoiseEmitterComponent.h"
+#include "Engine/World.h"
+#include "prototype/prototype.h"
+
+
+static float PerceptionInterval = 0.1f;
+FAutoConsoleVariableRef CVARPerceptionInterval(
+	TEXT("COOP.PerceptionInterval"),
+	PerceptionInterval,
+	TEXT("Seconds between two perception passes, each bot is only sensed once its own sensing interval passed"),
+	ECVF_Default);
+
+
+DECLARE_CYCLE_STAT(TEXT("Perception Update"), STAT_ShooterPerception, STATGROUP_ShooterAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Perception Bots Sensed"), STAT_ShooterPerceptionBots, STATGROUP_ShooterAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Perception Traces"), STAT_ShooterPerceptionTraces, STATGROUP_ShooterAI);
+
+
+void FShooterPerceptionBots::Reset()
+{
+	Bots.Reset();
+	PrevSenseTimes.Reset();
+	PosX.Reset();
+	PosY.Reset();
+	PosZ.Reset();
+	FwdX.Reset();
+	FwdY.Reset();
+	FwdZ.Reset();
+	SightRadiusSq.Reset();
+	SignedCosSq.Reset();
+	HearingSq.Reset();
+	LOSHearingSq.Reset();
+}
+
+
+void FShooterPerceptionBots::Add(AShooterZombieCharacter* Bot)
+{
+	const FVector Location = Bot->GetPawnViewLocation();
+	const FVector Forward = Bot->GetActorForwardVector();
+	const float Cosine = FMath::Cos(FMath::DegreesToRadians(Bot->PeripheralVisionAngle));
+
+	Bots.Add(Bot);
+	PrevSenseTimes.Add(Bot->LastSenseTime);
+	PosX.Add(Location.X);
+	PosY.Add(Location.Y);
+	PosZ.Add(Location.Z);
+	FwdX.Add(Forward.X);
+	FwdY.Add(Forward.Y);
+	FwdZ.Add(Forward.Z);
+	SightRadiusSq.Add(FMath::Square(Bot->SightRadius));
+	SignedCosSq.Add(Cosine * FMath::Abs(Cosine));
+	HearingSq.Add(FMath::Square(Bot->HearingThreshold));
+	LOSHearingSq.Add(FMath::Square(Bot->LOSHearingThreshold));
+}
+
+
+void FShooterPerceptionBots::Pad()
+{
+	while (PosX.Num() % 4 != 0)
+	{
+		PosX.Add(0.0f);
+		PosY.Add(0.0f);
+		PosZ.Add(0.0f);
+		FwdX.Add(0.0f);
+		FwdY.Add(0.0f);
+		FwdZ.Add(0.0f);
+		SightRadiusSq.Add(-1.0f);
+		SignedCosSq.Add(0.0f);
+		HearingSq.Add(-1.0f);
+		LOSHearingSq.Add(-1.0f);
+	}
+}
+
+
+UShooterPerceptionManager::UShooterPerceptionManager()
+{
+	NumPendingTraces = 0;
+	TimeUntilUpdate = 0.0f;
+}
+
+
+bool UShooterPerceptionManager::ShouldCreateSubsystem(UObject* Outer) const
+{
+	if (!Super::ShouldCreateSubsystem(Outer))
+	{
+		return false;
+	}
+
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+
+void UShooterPerceptionManager::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	TraceDelegate.BindUObject(this, &UShooterPerceptionManager::OnVisibilityTraceDone);
+}
+
+
+void UShooterPerceptionManager::Deinitialize()
+{
+	TraceDelegate.Unbind();
+	Batch.Reset();
+	Noises.Empty();
+	Traces.Empty();
+	NumPendingTraces = 0;
+
+	Super::Deinitialize();
+}
+
+
+void UShooterPerceptionManager::Tick(float DeltaTime)
+{
+	TimeUntilUpdate -= DeltaTime;
+
+	/* Wait for the traces of the previous pass, they come back next frame */
+	if (TimeUntilUpdate <= 0.0f && NumPendingTraces == 0)
+	{
+		TimeUntilUpdate = PerceptionInterval;
+		UpdatePerception(GetWorld()->GetTimeSeconds());
+	}
+}
+
+
+ETickableTickType UShooterPerceptionManager::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+
+bool UShooterPerceptionManager::IsTickable() const
+{
+	/* Bots are only controlled on the server */
+	return GetWorld()->GetNetMode() != NM_Client;
+}
+
+
+UWorld* UShooterPerceptionManager::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+
+TStatId UShooterPerceptionManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterPerceptionManager, STATGROUP_Tickables);
+}
+
+
+void UShooterPerceptionManager::UpdatePerception(float WorldTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterPerception);
+
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (!PawnRegistry)
+	{
+		return;
+	}
+
+	UShooterAISignificanceManager* SignificanceManager = GetWorld()->GetSubsystem<UShooterAISignificanceManager>();
+
+	/* Bots whose sensing interval passed, less significant bots sense less often */
+	Batch.Reset();
+	float OldestSenseTime = WorldTime;
+	PawnRegistry->ForEachPawn(EShooterPawnKind::Bot, true, [&](APawn* Pawn)
+	{
+		AShooterZombieCharacter* Bot = Cast<AShooterZombieCharacter>(Pawn);
+		if (!Bot)
+		{
+			return;
+		}
+
+		const float IntervalScale = SignificanceManager ? SignificanceManager->GetSensingIntervalScale(Bot) : 1.0f;
+		if (WorldTime - Bot->LastSenseTime >= Bot->SensingInterval * IntervalScale)
+		{
+			OldestSenseTime = FMath::Min(OldestSenseTime, Bot->LastSenseTime);
+			Batch.Add(Bot);
+			Bot->LastSenseTime = WorldTime;
+		}
+	});
+
+	SET_DWORD_STAT(STAT_ShooterPerceptionBots, Batch.Bots.Num());
+	SET_DWORD_STAT(STAT_ShooterPerceptionTraces, 0);
+
+	if (Batch.Bots.Num() == 0)
+	{
+		return;
+	}
+
+	Batch.Pad();
+
+	TArray<APawn*> Players;
+	Noises.Reset();
+	PawnRegistry->ForEachPawn(EShooterPawnKind::Player, true, [&](APawn* Player)
+	{
+		Players.Add(Player);
+
+		UPawnNoiseEmitterComponent* NoiseEmitter = Player->GetPawnNoiseEmitterComponent();
+		if (!NoiseEmitter)
+		{
+			return;
+		}
+
+		/* Noise made by the player itself, footsteps and weapon fire */
+		const float LocalNoiseTime = NoiseEmitter->GetLastNoiseTime(true);
+		if (LocalNoiseTime > OldestSenseTime)
+		{
+			FShooterPerceptionNoise& Noise = Noises.AddDefaulted_GetRef();
+			Noise.Instigator = Player;
+			Noise.Location = Player->GetActorLocation();
+			Noise.Volume = NoiseEmitter->GetLastNoiseVolume(true);
+			Noise.Time = LocalNoiseTime;
+		}
+
+		/* Noise the player made elsewhere, bullet impacts */
+		const float RemoteNoiseTime = NoiseEmitter->GetLastNoiseTime(false);
+		if (RemoteNoiseTime > OldestSenseTime)
+		{
+			FShooterPerceptionNoise& Noise = Noises.AddDefaulted_GetRef();
+			Noise.Instigator = Player;
+			Noise.Location = NoiseEmitter->LastRemoteNoisePosition;
+			Noise.Volume = NoiseEmitter->GetLastNoiseVolume(false);
+			Noise.Time = RemoteNoiseTime;
+		}
+	});
+
+	TArray<int32> SightCandidates;
+	FindSightCandidates(Players, SightCandidates);
+
+	TArray<int32> HeardNoises;
+	TArray<int32> NoiseCandidates;
+	FindNoiseCandidates(HeardNoises, NoiseCandidates);
+
+	Traces.Reset();
+	for (int32 BotIdx = 0; BotIdx < Batch.Bots.Num(); BotIdx++)
+	{
+		AShooterZombieCharacter* Bot = Batch.Bots[BotIdx];
+
+		if (HeardNoises[BotIdx] != INDEX_NONE)
+		{
+			const FShooterPerceptionNoise& Noise = Noises[HeardNoises[BotIdx]];
+			Bot->OnHearNoise(Noise.Instigator, Noise.Location, Noise.Volume);
+		}
+		else if (NoiseCandidates[BotIdx] != INDEX_NONE)
+		{
+			const FShooterPerceptionNoise& Noise = Noises[NoiseCandidates[BotIdx]];
+			QueueTrace(Bot, Noise.Instigator, Noise.Location, true, Noise.Volume);
+		}
+
+		if (SightCandidates[BotIdx] != INDEX_NONE)
+		{
+			APawn* Player = Players[SightCandidates[BotIdx]];
+			QueueTrace(Bot, Player, Player->GetActorLocation(), false, 0.0f);
+		}
+	}
+
+	NumPendingTraces = Traces.Num();
+	SET_DWORD_STAT(STAT_ShooterPerceptionTraces, Traces.Num());
+}
+
+
+void UShooterPerceptionManager::FindSightCandidates(const TArray<APawn*>& Players, TArray<int32>& OutCandidates) const
+{
+	OutCandidates.Init(INDEX_NONE, Batch.Bots.Num());
+
+	TArray<float> BestDistSq;
+	BestDistSq.Init(BIG_NUMBER, Batch.Bots.Num());
+
+	for (int32 PlayerIdx = 0; PlayerIdx < Players.Num(); PlayerIdx++)
+	{
+		const FVector PlayerLocation = Players[PlayerIdx]->GetActorLocation();
+		const VectorRegister PlayerX = VectorSetFloat1(PlayerLocation.X);
+		const VectorRegister PlayerY = VectorSetFloat1(PlayerLocation.Y);
+		const VectorRegister PlayerZ = VectorSetFloat1(PlayerLocation.Z);
+
+		for (int32 i = 0; i < Batch.PosX.Num(); i += 4)
+		{
+			const VectorRegister DeltaX = VectorSubtract(PlayerX, VectorLoad(&Batch.PosX[i]));
+			const VectorRegister DeltaY = VectorSubtract(PlayerY, VectorLoad(&Batch.PosY[i]));
+			const VectorRegister DeltaZ = VectorSubtract(PlayerZ, VectorLoad(&Batch.PosZ[i]));
+
+			const VectorRegister DistSq = VectorMultiplyAdd(DeltaX, DeltaX, VectorMultiplyAdd(DeltaY, DeltaY, VectorMultiply(DeltaZ, DeltaZ)));
+			const VectorRegister Dot = VectorMultiplyAdd(DeltaX, VectorLoad(&Batch.FwdX[i]),
+				VectorMultiplyAdd(DeltaY, VectorLoad(&Batch.FwdY[i]), VectorMultiply(DeltaZ, VectorLoad(&Batch.FwdZ[i]))));
+
+			/* Dot >= Cos * Dist without the square root, both sides squared keeping their sign */
+			const VectorRegister InRange = VectorCompareGE(VectorLoad(&Batch.SightRadiusSq[i]), DistSq);
+			const VectorRegister InCone = VectorCompareGE(VectorMultiply(Dot, VectorAbs(Dot)), VectorMultiply(VectorLoad(&Batch.SignedCosSq[i]), DistSq));
+
+			uint32 Mask = VectorMaskBits(VectorBitwiseAnd(InRange, InCone));
+			if (Mask == 0)
+			{
+				continue;
+			}
+
+			float LaneDistSq[4];
+			VectorStore(DistSq, LaneDistSq);
+
+			while (Mask != 0)
+			{
+				const int32 Lane = FMath::CountTrailingZeros(Mask);
+				Mask &= Mask - 1;
+
+				const int32 BotIdx = i + Lane;
+				if (LaneDistSq[Lane] < BestDistSq[BotIdx])
+				{
+					BestDistSq[BotIdx] = LaneDistSq[Lane];
+					OutCandidates[BotIdx] = PlayerIdx;
+				}
+			}
+		}
+	}
+}
+
+
+void UShooterPerceptionManager::FindNoiseCandidates(TArray<int32>& OutHeard, TArray<int32>& OutCandidates) const
+{
+	OutHeard.Init(INDEX_NONE, Batch.Bots.Num());
+	OutCandidates.Init(INDEX_NONE, Batch.Bots.Num());
+
+	TArray<float> BestHeardDistSq;
+	BestHeardDistSq.Init(BIG_NUMBER, Batch.Bots.Num());
+
+	TArray<float> BestCandidateDistSq;
+	BestCandidateDistSq.Init(BIG_NUMBER, Batch.Bots.Num());
+
+	for (int32 NoiseIdx = 0; NoiseIdx < Noises.Num(); NoiseIdx++)
+	{
+		const FShooterPerceptionNoise& Noise = Noises[NoiseIdx];
+		const VectorRegister NoiseX = VectorSetFloat1(Noise.Location.X);
+		const VectorRegister NoiseY = VectorSetFloat1(Noise.Location.Y);
+		const VectorRegister NoiseZ = VectorSetFloat1(Noise.Location.Z);
+
+		/* Hearing ranges scale with the loudness of the noise */
+		const VectorRegister VolumeSq = VectorSetFloat1(FMath::Square(Noise.Volume));
+
+		for (int32 i = 0; i < Batch.PosX.Num(); i += 4)
+		{
+			const VectorRegister DeltaX = VectorSubtract(NoiseX, VectorLoad(&Batch.PosX[i]));
+			const VectorRegister DeltaY = VectorSubtract(NoiseY, VectorLoad(&Batch.PosY[i]));
+			const VectorRegister DeltaZ = VectorSubtract(NoiseZ, VectorLoad(&Batch.PosZ[i]));
+
+			const VectorRegister DistSq = VectorMultiplyAdd(DeltaX, DeltaX, VectorMultiplyAdd(DeltaY, DeltaY, VectorMultiply(DeltaZ, DeltaZ)));
+			const VectorRegister InHearing = VectorCompareGE(VectorMultiply(VectorLoad(&Batch.HearingSq[i]), VolumeSq), DistSq);
+			const VectorRegister InLOSHearing = VectorCompareGE(VectorMultiply(VectorLoad(&Batch.LOSHearingSq[i]), VolumeSq), DistSq);
+
+			uint32 Mask = VectorMaskBits(InLOSHearing);
+			if (Mask == 0)
+			{
+				continue;
+			}
+
+			const uint32 HeardMask = VectorMaskBits(InHearing);
+
+			float LaneDistSq[4];
+			VectorStore(DistSq, LaneDistSq);
+
+			while (Mask != 0)
+			{
+				const int32 Lane = FMath::CountTrailingZeros(Mask);
+				Mask &= Mask - 1;
+
+				/* Only noises made since the bot last sensed */
+				const int32 BotIdx = i + Lane;
+				if (Noise.Time <= Batch.PrevSenseTimes[BotIdx])
+				{
+					continue;
+				}
+
+				if (HeardMask & (1 << Lane))
+				{
+					if (LaneDistSq[Lane] < BestHeardDistSq[BotIdx])
+					{
+						BestHeardDistSq[BotIdx] = LaneDistSq[Lane];
+						OutHeard[BotIdx] = NoiseIdx;
+					}
+				}
+				else if (LaneDistSq[Lane] < BestCandidateDistSq[BotIdx])
+				{
+					BestCandidateDistSq[BotIdx] = LaneDistSq[Lane];
+					OutCandidates[BotIdx] = NoiseIdx;
+				}
+			}
+		}
+	}
+}
+
+
+void UShooterPerceptionManager::QueueTrace(AShooterZombieCharacter* Bot, APawn* Target, const FVector& TargetLocation, bool bNoise, float NoiseVolume)
+{
+	const int32 TraceIdx = Traces.AddDefaulted();
+	FShooterPerceptionTrace& Trace = Traces[TraceIdx];
+	Trace.Bot = Bot;
+	Trace.Target = Target;
+	Trace.bNoise = bNoise;
+	Trace.TargetLocation = TargetLocation;
+	Trace.NoiseVolume = NoiseVolume;
+
+	FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(ShooterPerception), true, Bot);
+	TraceParams.AddIgnoredActor(Target);
+
+	/* Runs with all other async traces of the frame, the result is delivered next frame */
+	GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Test, Bot->GetPawnViewLocation(), TargetLocation, ECC_Visibility,
+		TraceParams, FCollisionResponseParams::DefaultResponseParam, &TraceDelegate, TraceIdx);
+}
+
+
+void UShooterPerceptionManager::OnVisibilityTraceDone(const FTraceHandle& Handle, FTraceDatum& Datum)
+{
+	NumPendingTraces = FMath::Max(NumPendingTraces - 1, 0);
+
+	if (!Traces.IsValidIndex(Datum.UserData) || FHitResult::GetFirstBlockingHit(Datum.OutHits))
+	{
+		return;
+	}
+
+	const FShooterPerceptionTrace& Trace = Traces[Datum.UserData];
+	AShooterZombieCharacter* Bot = Trace.Bot.Get();
+	APawn* Target = Trace.Target.Get();
+	if (!Bot || !Target || !Bot->IsAlive() || !UShooterPawnRegistry::IsPawnAlive(Target))
+	{
+		return;
+	}
+
+	if (Trace.bNoise)
+	{
+		Bot->OnHearNoise(Target, Trace.TargetLocation, Trace.NoiseVolume);
+	}
+	else
+	{
+		Bot->OnSeePlayer(Target);
+	}
+}
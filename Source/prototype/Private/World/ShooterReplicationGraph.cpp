@@ -0,0 +1,229 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterReplicationGraph.h"
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "ShooterWeapon.h"
+#include "ShooterCharacter.h"
+#include "ShooterExplosiveBarrel.h"
+#include "ShooterPowerupActor.h"
+#include "ShooterPowerupSpawner.h"
+#include "Items/ShooterPickupActor.h"
+#include "../prototype.h"
+
+
+UShooterReplicationGraph::UShooterReplicationGraph()
+{
+	GridCellSize = 10000.0f;
+	SpatialBiasX = -200000.0f;
+	SpatialBiasY = -200000.0f;
+	GameStateNetUpdateFrequency = 5.0f;
+}
+
+
+void UShooterReplicationGraph::BeginDestroy()
+{
+	AShooterWeapon::NotifyOwnerChanged.Remove(WeaponOwnerChangedHandle);
+
+	Super::BeginDestroy();
+}
+
+
+EShooterClassRepNodeMapping UShooterReplicationGraph::GetMappingPolicy(UClass* Class)
+{
+	EShooterClassRepNodeMapping* Policy = ClassRepNodePolicies.Get(Class);
+	return Policy ? *Policy : EShooterClassRepNodeMapping::NotRouted;
+}
+
+
+EShooterClassRepNodeMapping UShooterReplicationGraph::GetDefaultMappingPolicy(const AActor* ActorCDO) const
+{
+	if (ActorCDO->bOnlyRelevantToOwner)
+	{
+		/* Picked up by the connection node through the viewer */
+		return EShooterClassRepNodeMapping::NotRouted;
+	}
+
+	if (ActorCDO->bAlwaysRelevant)
+	{
+		return EShooterClassRepNodeMapping::RelevantAllConnections;
+	}
+
+	return EShooterClassRepNodeMapping::Spatialize_Dynamic;
+}
+
+
+void UShooterReplicationGraph::InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class, bool bSpatialize,
+                                                        float NetUpdateFrequency) const
+{
+	AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+	if (bSpatialize)
+	{
+		Info.SetCullDistanceSquared(ActorCDO->NetCullDistanceSquared);
+	}
+
+	const float ServerMaxTickRate = NetDriver ? NetDriver->NetServerMaxTickRate : 30.0f;
+	Info.ReplicationPeriodFrame = FMath::Max<uint32>(
+		(uint32)FMath::RoundToFloat(ServerMaxTickRate / FMath::Max(NetUpdateFrequency, 1.0f)), 1);
+}
+
+
+void UShooterReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	/* Explicit routing, everything else is resolved from the actor's relevancy flags below */
+	ClassRepNodePolicies.Set(ALevelScriptActor::StaticClass(), EShooterClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(APlayerController::StaticClass(), EShooterClassRepNodeMapping::NotRouted);
+	/* PlayerStates are gathered by the frequency limiter node */
+	ClassRepNodePolicies.Set(APlayerState::StaticClass(), EShooterClassRepNodeMapping::NotRouted);
+	/* Weapons only replicate as dependents of their owner */
+	ClassRepNodePolicies.Set(AShooterWeapon::StaticClass(), EShooterClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(AGameStateBase::StaticClass(), EShooterClassRepNodeMapping::RelevantAllConnections);
+	ClassRepNodePolicies.Set(APawn::StaticClass(), EShooterClassRepNodeMapping::Spatialize_Dynamic);
+	ClassRepNodePolicies.Set(AShooterPickupActor::StaticClass(), EShooterClassRepNodeMapping::Spatialize_Dormancy);
+	ClassRepNodePolicies.Set(AShooterExplosiveBarrel::StaticClass(), EShooterClassRepNodeMapping::Spatialize_Dormancy);
+	ClassRepNodePolicies.Set(AShooterPowerupActor::StaticClass(), EShooterClassRepNodeMapping::Spatialize_Dormancy);
+	ClassRepNodePolicies.Set(AShooterPowerupSpawner::StaticClass(), EShooterClassRepNodeMapping::Spatialize_Dormancy);
+
+	TArray<UClass*> ReplicatedClasses;
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+		if (!ActorCDO || !ActorCDO->GetIsReplicated())
+		{
+			continue;
+		}
+
+		/* Skip blueprint skeleton and reinstanced classes */
+		const FString ClassName = Class->GetName();
+		if (ClassName.StartsWith(TEXT("SKEL_")) || ClassName.StartsWith(TEXT("REINST_")))
+		{
+			continue;
+		}
+
+		ReplicatedClasses.Add(Class);
+
+		if (!ClassRepNodePolicies.Contains(Class, true))
+		{
+			ClassRepNodePolicies.Set(Class, GetDefaultMappingPolicy(ActorCDO));
+		}
+	}
+
+	for (UClass* Class : ReplicatedClasses)
+	{
+		const EShooterClassRepNodeMapping Policy = GetMappingPolicy(Class);
+		const bool bSpatialize = Policy >= EShooterClassRepNodeMapping::Spatialize_Static;
+
+		float NetUpdateFrequency = Class->GetDefaultObject<AActor>()->NetUpdateFrequency;
+		if (Class->IsChildOf(AGameStateBase::StaticClass()))
+		{
+			NetUpdateFrequency = GameStateNetUpdateFrequency;
+		}
+
+		FClassReplicationInfo ClassInfo;
+		InitClassReplicationInfo(ClassInfo, Class, bSpatialize, NetUpdateFrequency);
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	}
+
+	WeaponOwnerChangedHandle = AShooterWeapon::NotifyOwnerChanged.AddUObject(this, &UShooterReplicationGraph::OnWeaponOwnerChanged);
+}
+
+
+void UShooterReplicationGraph::InitGlobalGraphNodes()
+{
+	Super::InitGlobalGraphNodes();
+
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = FVector2D(SpatialBiasX, SpatialBiasY);
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+
+	/* Always relevant, but only a few PlayerStates are replicated each frame */
+	UReplicationGraphNode_PlayerStateFrequencyLimiter* PlayerStateNode = CreateNewNode<UReplicationGraphNode_PlayerStateFrequencyLimiter>();
+	AddGlobalGraphNode(PlayerStateNode);
+}
+
+
+void UShooterReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	/* The connection's own controller and view target */
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* AlwaysRelevantConnectionNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantConnectionNode, RepGraphConnection);
+}
+
+
+void UShooterReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo,
+                                                           FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case EShooterClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+	case EShooterClassRepNodeMapping::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+	case EShooterClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+	case EShooterClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+	default:
+		break;
+	}
+}
+
+
+void UShooterReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case EShooterClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case EShooterClassRepNodeMapping::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+	case EShooterClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+	case EShooterClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+	default:
+		break;
+	}
+}
+
+
+void UShooterReplicationGraph::OnWeaponOwnerChanged(AShooterWeapon* Weapon, AShooterCharacter* OldOwner,
+                                                    AShooterCharacter* NewOwner)
+{
+	if (!Weapon || Weapon->GetWorld() != GetWorld())
+	{
+		return;
+	}
+
+	if (OldOwner)
+	{
+		RemoveDependentActor(OldOwner, Weapon);
+	}
+
+	if (NewOwner)
+	{
+		AddDependentActor(NewOwner, Weapon);
+	}
+}
@@ -0,0 +1,372 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterSpatialHash.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "../prototype.h"
+
+
+FShooterSpatialHash::FShooterSpatialHash(float InCellSize)
+	: CellSize(FMath::Max(InCellSize, 1.0f)),
+	  InvCellSize(1.0f / FMath::Max(InCellSize, 1.0f)),
+	  NumEntries(0),
+	  MaxEntryRadius(0.0f)
+{
+}
+
+
+void FShooterSpatialHash::Reset()
+{
+	Cells.Reset();
+	CellLookup.Reset();
+	EntrySlots.Reset();
+	NumEntries = 0;
+	MaxEntryRadius = 0.0f;
+}
+
+
+void FShooterSpatialHash::Add(int32 Id, const FVector& Location, int32 Team, float Radius, float HalfHeight)
+{
+	check(Id >= 0);
+
+	if (Contains(Id))
+	{
+		Remove(Id);
+	}
+
+	if (EntrySlots.Num() <= Id)
+	{
+		EntrySlots.Reserve(Id + 1);
+		while (EntrySlots.Num() <= Id)
+		{
+			EntrySlots.Add(FIntPoint(INDEX_NONE, INDEX_NONE));
+		}
+	}
+
+	AddToCell(Id, FindOrAddCell(GetCellKey(Location.X, Location.Y)), Location, Team, Radius, HalfHeight);
+
+	NumEntries++;
+	MaxEntryRadius = FMath::Max(MaxEntryRadius, Radius);
+}
+
+
+void FShooterSpatialHash::Remove(int32 Id)
+{
+	if (!Contains(Id))
+	{
+		return;
+	}
+
+	const FIntPoint Slot = EntrySlots[Id];
+	RemoveFromCell(Slot.X, Slot.Y);
+	EntrySlots[Id] = FIntPoint(INDEX_NONE, INDEX_NONE);
+
+	NumEntries--;
+}
+
+
+void FShooterSpatialHash::Move(int32 Id, const FVector& Location)
+{
+	if (!Contains(Id))
+	{
+		return;
+	}
+
+	const FIntPoint Slot = EntrySlots[Id];
+	FCell& Cell = Cells[Slot.X];
+
+	const FIntPoint NewKey = GetCellKey(Location.X, Location.Y);
+	if (NewKey == Cell.Key)
+	{
+		Cell.X[Slot.Y] = Location.X;
+		Cell.Y[Slot.Y] = Location.Y;
+		Cell.Z[Slot.Y] = Location.Z;
+		return;
+	}
+
+	const int32 Team = Cell.Teams[Slot.Y];
+	const float Radius = Cell.Radii[Slot.Y];
+	const float HalfHeight = Cell.HalfHeights[Slot.Y];
+
+	RemoveFromCell(Slot.X, Slot.Y);
+	AddToCell(Id, FindOrAddCell(NewKey), Location, Team, Radius, HalfHeight);
+}
+
+
+void FShooterSpatialHash::SetTeam(int32 Id, int32 Team)
+{
+	if (Contains(Id))
+	{
+		const FIntPoint Slot = EntrySlots[Id];
+		Cells[Slot.X].Teams[Slot.Y] = Team;
+	}
+}
+
+
+int32 FShooterSpatialHash::FindOrAddCell(const FIntPoint& Key)
+{
+	const int32* CellIndex = CellLookup.Find(Key);
+	if (CellIndex)
+	{
+		return *CellIndex;
+	}
+
+	const int32 NewIndex = Cells.AddDefaulted();
+	Cells[NewIndex].Key = Key;
+	CellLookup.Add(Key, NewIndex);
+
+	return NewIndex;
+}
+
+
+void FShooterSpatialHash::AddToCell(int32 Id, int32 CellIndex, const FVector& Location, int32 Team, float Radius, float HalfHeight)
+{
+	FCell& Cell = Cells[CellIndex];
+
+	const int32 SlotIndex = Cell.Ids.Add(Id);
+	Cell.X.Add(Location.X);
+	Cell.Y.Add(Location.Y);
+	Cell.Z.Add(Location.Z);
+	Cell.Radii.Add(Radius);
+	Cell.HalfHeights.Add(HalfHeight);
+	Cell.Teams.Add(Team);
+
+	EntrySlots[Id] = FIntPoint(CellIndex, SlotIndex);
+}
+
+
+void FShooterSpatialHash::RemoveFromCell(int32 CellIndex, int32 SlotIndex)
+{
+	FCell& Cell = Cells[CellIndex];
+
+	/* Swap remove on all arrays, then fix the slot of the entry that filled the gap */
+	Cell.Ids.RemoveAtSwap(SlotIndex, 1, false);
+	Cell.X.RemoveAtSwap(SlotIndex, 1, false);
+	Cell.Y.RemoveAtSwap(SlotIndex, 1, false);
+	Cell.Z.RemoveAtSwap(SlotIndex, 1, false);
+	Cell.Radii.RemoveAtSwap(SlotIndex, 1, false);
+	Cell.HalfHeights.RemoveAtSwap(SlotIndex, 1, false);
+	Cell.Teams.RemoveAtSwap(SlotIndex, 1, false);
+
+	if (SlotIndex < Cell.Ids.Num())
+	{
+		EntrySlots[Cell.Ids[SlotIndex]].Y = SlotIndex;
+	}
+}
+
+
+int32 FShooterSpatialHash::FindNearest(const FVector& Center, float MaxRadius, int32 Team, EShooterTeamFilter Filter, int32 MaxResults, int32* OutIds, float* OutDistSq) const
+{
+	if (MaxResults <= 0 || NumEntries == 0)
+	{
+		return 0;
+	}
+
+	/* Small sorted buffer of the best candidates, worst last */
+	static const int32 MaxBuffered = 32;
+	const int32 NumWanted = FMath::Min(MaxResults, MaxBuffered);
+	int32 BestIds[MaxBuffered];
+	float BestDistSq[MaxBuffered];
+	int32 NumFound = 0;
+
+	auto ConsiderCell = [&](const FCell& Cell)
+	{
+		const int32 NumInCell = Cell.Ids.Num();
+		const float* RESTRICT X = Cell.X.GetData();
+		const float* RESTRICT Y = Cell.Y.GetData();
+		const float* RESTRICT Z = Cell.Z.GetData();
+
+		for (int32 i = 0; i < NumInCell; i++)
+		{
+			const float DX = X[i] - Center.X;
+			const float DY = Y[i] - Center.Y;
+			const float DZ = Z[i] - Center.Z;
+			const float DistSq = DX * DX + DY * DY + DZ * DZ;
+
+			const float WorstDistSq = NumFound == NumWanted ? BestDistSq[NumFound - 1] : MaxRadius * MaxRadius;
+			if (DistSq > WorstDistSq || !PassesTeamFilter(Cell.Teams[i], Team, Filter))
+			{
+				continue;
+			}
+
+			/* Insertion sort into the buffer */
+			int32 InsertIdx = FMath::Min(NumFound, NumWanted - 1);
+			while (InsertIdx > 0 && BestDistSq[InsertIdx - 1] > DistSq)
+			{
+				BestIds[InsertIdx] = BestIds[InsertIdx - 1];
+				BestDistSq[InsertIdx] = BestDistSq[InsertIdx - 1];
+				InsertIdx--;
+			}
+
+			BestIds[InsertIdx] = Cell.Ids[i];
+			BestDistSq[InsertIdx] = DistSq;
+			NumFound = FMath::Min(NumFound + 1, NumWanted);
+		}
+	};
+
+	const FIntPoint CenterKey = GetCellKey(Center.X, Center.Y);
+	const int32 MaxRing = FMath::CeilToInt(FMath::Min(MaxRadius * InvCellSize, 16384.0f));
+
+	/* Walking rings only pays off while they cover fewer cells than exist */
+	const int64 RingCells = int64(2 * MaxRing + 1) * int64(2 * MaxRing + 1);
+	if (RingCells >= Cells.Num())
+	{
+		for (const FCell& Cell : Cells)
+		{
+			if (Cell.Ids.Num() > 0)
+			{
+				ConsiderCell(Cell);
+			}
+		}
+	}
+	else
+	{
+		for (int32 Ring = 0; Ring <= MaxRing; Ring++)
+		{
+			/* Any entry in this ring is at least (Ring - 1) cells away */
+			if (NumFound == NumWanted && Ring > 1 && FMath::Square((Ring - 1) * CellSize) > BestDistSq[NumFound - 1])
+			{
+				break;
+			}
+
+			for (int32 CellY = CenterKey.Y - Ring; CellY <= CenterKey.Y + Ring; CellY++)
+			{
+				const bool bEdgeRow = CellY == CenterKey.Y - Ring || CellY == CenterKey.Y + Ring;
+				const int32 StepX = bEdgeRow ? 1 : FMath::Max(2 * Ring, 1);
+
+				for (int32 CellX = CenterKey.X - Ring; CellX <= CenterKey.X + Ring; CellX += StepX)
+				{
+					const int32* CellIndex = CellLookup.Find(FIntPoint(CellX, CellY));
+					if (CellIndex)
+					{
+						ConsiderCell(Cells[*CellIndex]);
+					}
+				}
+			}
+		}
+	}
+
+	for (int32 i = 0; i < NumFound; i++)
+	{
+		OutIds[i] = BestIds[i];
+		if (OutDistSq)
+		{
+			OutDistSq[i] = BestDistSq[i];
+		}
+	}
+
+	return NumFound;
+}
+
+
+bool FShooterSpatialHash::OverlapsCapsule(const FVector& Center, float Radius, float HalfHeight, int32 Team, EShooterTeamFilter Filter) const
+{
+	bool bOverlaps = false;
+
+	ForEachCellInRange(Center, Radius + MaxEntryRadius, [&](const FCell& Cell)
+	{
+		const int32 NumInCell = Cell.Ids.Num();
+		for (int32 i = 0; i < NumInCell && !bOverlaps; i++)
+		{
+			const float CombinedHeight = (HalfHeight + Cell.HalfHeights[i]) * 2.0f;
+			const float CombinedWidth = Radius + Cell.Radii[i];
+			const float DX = Cell.X[i] - Center.X;
+			const float DY = Cell.Y[i] - Center.Y;
+
+			bOverlaps = FMath::Abs(Cell.Z[i] - Center.Z) < CombinedHeight && DX * DX + DY * DY < CombinedWidth * CombinedWidth
+				&& PassesTeamFilter(Cell.Teams[i], Team, Filter);
+		}
+	});
+
+	return bOverlaps;
+}
+
+
+/* Compares hash queries against a brute force scan over synthetic agents, use "COOP.BenchSpatialHash [NumQueries]" */
+static void BenchSpatialHash(const TArray<FString>& Args)
+{
+	const int32 NumQueries = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1000;
+	const int32 AgentCounts[] = { 50, 200, 1000 };
+
+	/* Roughly the playable area of the coop maps */
+	const float WorldExtent = 10000.0f;
+	const float QueryRadius = 600.0f;
+
+	for (int32 NumAgents : AgentCounts)
+	{
+		FRandomStream Stream(NumAgents);
+		FShooterSpatialHash Hash;
+
+		TArray<FVector> Locations;
+		TArray<int32> Teams;
+		for (int32 i = 0; i < NumAgents; i++)
+		{
+			Locations.Add(FVector(Stream.FRandRange(-WorldExtent, WorldExtent), Stream.FRandRange(-WorldExtent, WorldExtent), Stream.FRandRange(0.0f, 500.0f)));
+			Teams.Add(Stream.RandHelper(2));
+			Hash.Add(i, Locations[i], Teams[i], 42.0f, 96.0f);
+		}
+
+		TArray<FVector> QueryPoints;
+		for (int32 i = 0; i < NumQueries; i++)
+		{
+			QueryPoints.Add(Locations[Stream.RandHelper(NumAgents)]);
+		}
+
+		/* Checksums keep the loops from being optimized away and must match between both methods */
+		int32 BruteRadiusHits = 0;
+		int32 BruteNearest = 0;
+		double StartTime = FPlatformTime::Seconds();
+		for (const FVector& Point : QueryPoints)
+		{
+			float BestDistSq = MAX_FLT;
+			int32 BestId = INDEX_NONE;
+			for (int32 i = 0; i < NumAgents; i++)
+			{
+				const float DistSq = FVector::DistSquared(Locations[i], Point);
+				BruteRadiusHits += DistSq <= QueryRadius * QueryRadius ? 1 : 0;
+				if (Teams[i] != 0 && DistSq < BestDistSq)
+				{
+					BestDistSq = DistSq;
+					BestId = i;
+				}
+			}
+			BruteNearest += BestId;
+		}
+		const double BruteTime = FPlatformTime::Seconds() - StartTime;
+
+		int32 HashRadiusHits = 0;
+		int32 HashNearest = 0;
+		StartTime = FPlatformTime::Seconds();
+		for (const FVector& Point : QueryPoints)
+		{
+			Hash.ForEachInRadius(Point, QueryRadius, INDEX_NONE, EShooterTeamFilter::Any, [&](int32 Id, float DistSq)
+			{
+				HashRadiusHits++;
+			});
+
+			int32 BestId = INDEX_NONE;
+			Hash.FindNearest(Point, BIG_NUMBER, 0, EShooterTeamFilter::OtherTeam, 1, &BestId);
+			HashNearest += BestId;
+		}
+		const double HashTime = FPlatformTime::Seconds() - StartTime;
+
+		/* Simulate a frame of movement, every agent takes a small step */
+		StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumAgents; i++)
+		{
+			Locations[i] += FVector(Stream.FRandRange(-10.0f, 10.0f), Stream.FRandRange(-10.0f, 10.0f), 0.0f);
+			Hash.Move(i, Locations[i]);
+		}
+		const double MoveTime = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogGame, Log, TEXT("SpatialHash %4d agents, %d queries: brute force %.3f ms, hash %.3f ms, update %.4f ms (%s)"),
+			NumAgents, NumQueries, BruteTime * 1000.0, HashTime * 1000.0, MoveTime * 1000.0,
+			(BruteRadiusHits == HashRadiusHits && BruteNearest == HashNearest) ? TEXT("results match") : TEXT("RESULTS DIFFER"));
+	}
+}
+
+static FAutoConsoleCommand BenchSpatialHashCmd(
+	TEXT("COOP.BenchSpatialHash"),
+	TEXT("Benchmarks spatial hash radius and nearest queries against brute force with 50, 200 and 1000 agents."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(BenchSpatialHash));
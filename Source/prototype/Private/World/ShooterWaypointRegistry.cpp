@@ -0,0 +1,276 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterWaypointRegistry.h"
+#include "World/ShooterPawnRegistry.h"
+#include "AI/ShooterBotWaypoint.h"
+#include "NavigationSystem.h"
+
+
+/* Distance at which a waypoint is half as likely to be picked as one right next to the bot */
+static const float WaypointDistanceFalloff = 2000.0f;
+
+/* Pawns within this radius of a waypoint count as crowding it */
+static const float WaypointCrowdingRadius = 500.0f;
+
+/* Chance to keep a drawn waypoint is 1 / (1 + Crowding * WaypointCrowdingWeight) */
+static const float WaypointCrowdingWeight = 0.5f;
+
+/* Draws before the last drawn waypoint is taken regardless of crowding */
+static const int32 MaxWaypointDraws = 4;
+
+
+UShooterWaypointRegistry::UShooterWaypointRegistry()
+{
+	bAliasTablesDirty = false;
+}
+
+
+void UShooterWaypointRegistry::Deinitialize()
+{
+	Entries.Empty();
+	WaypointIndices.Empty();
+	AliasProbs.Empty();
+	AliasIndices.Empty();
+
+	Super::Deinitialize();
+}
+
+
+void UShooterWaypointRegistry::RegisterWaypoint(AShooterBotWaypoint* Waypoint)
+{
+	if (Waypoint == nullptr || WaypointIndices.Contains(Waypoint))
+	{
+		return;
+	}
+
+	WaypointIndices.Add(Waypoint, Entries.Num());
+
+	FShooterWaypointEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Waypoint = Waypoint;
+	Entry.Location = Waypoint->GetActorLocation();
+
+	bAliasTablesDirty = true;
+}
+
+
+void UShooterWaypointRegistry::UnregisterWaypoint(AShooterBotWaypoint* Waypoint)
+{
+	int32 WaypointIdx;
+	if (!WaypointIndices.RemoveAndCopyValue(Waypoint, WaypointIdx))
+	{
+		return;
+	}
+
+	Entries.RemoveAtSwap(WaypointIdx);
+	if (Entries.IsValidIndex(WaypointIdx))
+	{
+		WaypointIndices[Entries[WaypointIdx].Waypoint] = WaypointIdx;
+	}
+
+	bAliasTablesDirty = true;
+}
+
+
+AShooterBotWaypoint* UShooterWaypointRegistry::PickWaypoint(APawn* Bot, AActor* CurrentWaypoint)
+{
+	const int32 NumWaypoints = Entries.Num();
+	if (NumWaypoints == 0)
+	{
+		return nullptr;
+	}
+
+	if (bAliasTablesDirty)
+	{
+		BuildAliasTables();
+	}
+
+	const int32* CurrentIdx = WaypointIndices.Find(CurrentWaypoint);
+	int32 SourceIdx = CurrentIdx ? *CurrentIdx : INDEX_NONE;
+	if (SourceIdx == INDEX_NONE)
+	{
+		SourceIdx = Bot ? FindNearestWaypoint(Bot->GetActorLocation()) : FMath::RandHelper(NumWaypoints);
+	}
+
+	const int32 RowStart = SourceIdx * NumWaypoints;
+
+	int32 PickedIdx = INDEX_NONE;
+	for (int32 Draw = 0; Draw < MaxWaypointDraws; Draw++)
+	{
+		const int32 Column = FMath::RandHelper(NumWaypoints);
+		PickedIdx = FMath::FRand() < AliasProbs[RowStart + Column] ? Column : AliasIndices[RowStart + Column];
+
+		const float KeepChance = 1.0f / (1.0f + GetCrowding(PickedIdx, Bot) * WaypointCrowdingWeight);
+		if (FMath::FRand() < KeepChance)
+		{
+			break;
+		}
+	}
+
+	return Entries[PickedIdx].Waypoint;
+}
+
+
+bool UShooterWaypointRegistry::GetPatrolLocation(AActor* Waypoint, FVector& OutLocation)
+{
+	const int32* WaypointIdx = WaypointIndices.Find(Waypoint);
+	if (!WaypointIdx)
+	{
+		return false;
+	}
+
+	FShooterWaypointEntry& Entry = Entries[*WaypointIdx];
+
+	/* Sampled on first use, the navmesh may not be ready yet when waypoints begin play */
+	if (Entry.NumPatrolPoints == 0)
+	{
+		SamplePatrolPoints(Entry);
+
+		if (Entry.NumPatrolPoints == 0)
+		{
+			return false;
+		}
+	}
+
+	OutLocation = Entry.PatrolPoints[FMath::RandHelper(Entry.NumPatrolPoints)];
+	return true;
+}
+
+
+void UShooterWaypointRegistry::BuildAliasTables()
+{
+	bAliasTablesDirty = false;
+
+	const int32 NumWaypoints = Entries.Num();
+	AliasProbs.SetNumUninitialized(NumWaypoints * NumWaypoints);
+	AliasIndices.SetNumUninitialized(NumWaypoints * NumWaypoints);
+
+	TArray<float> Weights;
+	Weights.SetNumUninitialized(NumWaypoints);
+
+	TArray<int32> Small;
+	TArray<int32> Large;
+	Small.Reserve(NumWaypoints);
+	Large.Reserve(NumWaypoints);
+
+	for (int32 SourceIdx = 0; SourceIdx < NumWaypoints; SourceIdx++)
+	{
+		/* Closer waypoints are more likely, the source itself only if it is the only one */
+		float TotalWeight = 0.0f;
+		for (int32 i = 0; i < NumWaypoints; i++)
+		{
+			const float Distance = FVector::Dist(Entries[SourceIdx].Location, Entries[i].Location);
+			Weights[i] = i == SourceIdx ? 0.0f : 1.0f / (1.0f + Distance / WaypointDistanceFalloff);
+			TotalWeight += Weights[i];
+		}
+
+		if (TotalWeight <= 0.0f)
+		{
+			for (int32 i = 0; i < NumWaypoints; i++)
+			{
+				Weights[i] = 1.0f;
+			}
+			TotalWeight = NumWaypoints;
+		}
+
+		/* Vose's alias method, scale weights to an average of 1 and pair each small column with a large one */
+		Small.Reset();
+		Large.Reset();
+		for (int32 i = 0; i < NumWaypoints; i++)
+		{
+			Weights[i] *= NumWaypoints / TotalWeight;
+			(Weights[i] < 1.0f ? Small : Large).Add(i);
+		}
+
+		float* Probs = &AliasProbs[SourceIdx * NumWaypoints];
+		int32* Aliases = &AliasIndices[SourceIdx * NumWaypoints];
+
+		while (Small.Num() > 0 && Large.Num() > 0)
+		{
+			const int32 SmallIdx = Small.Pop(false);
+			const int32 LargeIdx = Large.Last();
+
+			Probs[SmallIdx] = Weights[SmallIdx];
+			Aliases[SmallIdx] = LargeIdx;
+
+			Weights[LargeIdx] = (Weights[LargeIdx] + Weights[SmallIdx]) - 1.0f;
+			if (Weights[LargeIdx] < 1.0f)
+			{
+				Large.Pop(false);
+				Small.Add(LargeIdx);
+			}
+		}
+
+		/* Whatever is left is 1 up to rounding errors */
+		for (int32 i : Small)
+		{
+			Probs[i] = 1.0f;
+			Aliases[i] = i;
+		}
+
+		for (int32 i : Large)
+		{
+			Probs[i] = 1.0f;
+			Aliases[i] = i;
+		}
+	}
+}
+
+
+int32 UShooterWaypointRegistry::FindNearestWaypoint(const FVector& Location) const
+{
+	int32 BestIdx = INDEX_NONE;
+	float BestDistSq = BIG_NUMBER;
+	for (int32 i = 0; i < Entries.Num(); i++)
+	{
+		const float DistSq = FVector::DistSquared(Entries[i].Location, Location);
+		if (DistSq < BestDistSq)
+		{
+			BestDistSq = DistSq;
+			BestIdx = i;
+		}
+	}
+
+	return BestIdx;
+}
+
+
+int32 UShooterWaypointRegistry::GetCrowding(int32 WaypointIdx, APawn* Bot) const
+{
+	UShooterPawnRegistry* PawnRegistry = GetWorld()->GetSubsystem<UShooterPawnRegistry>();
+	if (!PawnRegistry)
+	{
+		return 0;
+	}
+
+	int32 Crowding = 0;
+	PawnRegistry->ForEachPawnInRadius(Entries[WaypointIdx].Location, WaypointCrowdingRadius, INDEX_NONE, EShooterTeamFilter::Any,
+		[&](APawn* Pawn, float DistSq)
+	{
+		if (Pawn != Bot)
+		{
+			Crowding++;
+		}
+	});
+
+	return Crowding;
+}
+
+
+void UShooterWaypointRegistry::SamplePatrolPoints(FShooterWaypointEntry& Entry)
+{
+	UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (!NavSystem)
+	{
+		return;
+	}
+
+	for (int32 i = 0; i < FShooterWaypointEntry::MaxPatrolPoints; i++)
+	{
+		FNavLocation ResultLocation;
+		if (NavSystem->GetRandomPointInNavigableRadius(Entry.Location, Entry.Waypoint->PatrolRadius, ResultLocation))
+		{
+			Entry.PatrolPoints[Entry.NumPatrolPoints++] = ResultLocation.Location;
+		}
+	}
+}
@@ -14,6 +14,13 @@ class PROTOTYPE_API UBTTask_FindPatrolLocation : public UBTTask_BlackboardBase
 {
 	GENERATED_BODY()	
 
+public:
+	UBTTask_FindPatrolLocation();
+
 	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
 
+	/* Draw from the points the waypoint registry sampled around the waypoint instead of querying the navmesh each time */
+	UPROPERTY(EditAnywhere, Category = Node)
+	bool bUsePresampledPoints;
+
 };
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/Tasks/BTTask_BlackboardBase.h"
+#include "BTTask_MoveAlongFlowField.generated.h"
+
+
+struct FBTMoveAlongFlowFieldMemory
+{
+	/* Following a regular path while the flow field of the target is not available */
+	bool bPathFallback;
+};
+
+
+/**
+ * Blackboard Task - Moves towards the target actor by following the shared flow field of the target,
+ * falls back to regular path following until the field is ready
+ */
+UCLASS()
+class PROTOTYPE_API UBTTask_MoveAlongFlowField : public UBTTask_BlackboardBase
+{
+	GENERATED_BODY()
+
+	UBTTask_MoveAlongFlowField();
+
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+	virtual EBTNodeResult::Type AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+	virtual void TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+
+	virtual uint16 GetInstanceMemorySize() const override;
+
+	/* Succeeds once this close to the target */
+	UPROPERTY(EditAnywhere, Category = "Node")
+	float AcceptableRadius;
+
+	/* Min distance of the point we steer towards, smooths out the steps between grid cells */
+	UPROPERTY(EditAnywhere, Category = "Node")
+	float SteeringLookahead;
+};
@@ -8,13 +8,21 @@
 
 /**
  * Waypoint helper for bots to generate waypoints during patrols. Object is placed in level to specify a potential patrol target location.
+ * Waypoints register with the UShooterWaypointRegistry while in play.
  */
 UCLASS()
 class PROTOTYPE_API AShooterBotWaypoint : public ATargetPoint
 {
 	GENERATED_BODY()
-	
-	
-	
-	
+
+public:
+	AShooterBotWaypoint();
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/* Radius around the waypoint that patrol locations are picked in */
+	UPROPERTY(EditAnywhere, Category = "Patrol")
+	float PatrolRadius;
 };
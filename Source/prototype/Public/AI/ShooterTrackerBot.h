@@ -23,6 +23,8 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	UPROPERTY(VisibleDefaultsOnly, Category = "Components")
 	UStaticMeshComponent* MeshComp;
 
@@ -50,6 +52,14 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "TrackerBot")
 	float RequiredDistanceToTarget;
 
+	/* Radius searched for the nearest target first, the whole level is only searched if no one is within it */
+	UPROPERTY(EditDefaultsOnly, Category = "TrackerBot")
+	float TargetSearchRadius;
+
+	/* Steer along the shared flow field of the target, regular paths are only used until it is ready */
+	UPROPERTY(EditDefaultsOnly, Category = "TrackerBot")
+	bool bUseFlowField;
+
 	//Dynamic material to pulse on damge
 	UMaterialInstanceDynamic* MatInst;
 
@@ -87,6 +97,11 @@ public:
 
 	virtual void NotifyActorBeginOverlap(AActor* OtherActor) override;
 
+	bool IsExploded() const
+	{
+		return bExploded;
+	}
+
 protected:
 
 	// CHALLENGE CODE	
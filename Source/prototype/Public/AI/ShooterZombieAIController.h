@@ -20,6 +20,9 @@ class PROTOTYPE_API AShooterZombieAIController : public AAIController
 
 	AShooterZombieAIController();
 
+	/* Removes the perception component added by the Blueprint controller, bots are sensed by the UShooterPerceptionManager */
+	virtual void PostInitializeComponents() override;
+
 	/* Called whenever the controller possesses a character bot */
 	virtual void OnPossess(class APawn* InPawn) override;
 
@@ -53,6 +56,9 @@ public:
 
 	void SetBlackboardBotType(EBotBehaviorType NewType);
 
+	/* Clear the sensed target and navigation keys, used when a pooled bot is reused */
+	void ResetBlackboard(EBotBehaviorType NewType);
+
 	/** Returns BehaviorComp subobject **/
 	FORCEINLINE UBehaviorTreeComponent* GetBehaviorComp() const { return BehaviorComp; }
 
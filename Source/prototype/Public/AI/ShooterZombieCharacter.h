@@ -22,16 +22,13 @@ class PROTOTYPE_API AShooterZombieCharacter : public AShooterBaseCharacter
 	/* Last time we attacked something */
 	float LastMeleeAttackTime;
 
-	/* Time-out value to clear the sensed position of the player. Should be higher than Sense interval in the PawnSense component not never miss sense ticks. */
+	/* Time-out value to clear the sensed position of the player. Should be higher than SensingInterval to never miss sense ticks. */
 	UPROPERTY(EditDefaultsOnly, Category = "AI")
 	float SenseTimeOut;
 
 	/* Resets after sense time-out to avoid unnecessary clearing of target each tick */
 	bool bSensedTarget;
 
-	UPROPERTY(VisibleAnywhere, Category = "AI")
-	class UPawnSensingComponent* PawnSensingComp;
-
 	virtual void BeginPlay() override;
 
 	virtual void Tick(float DeltaSeconds) override;
@@ -43,14 +40,6 @@ protected:
 	UFUNCTION(BlueprintCallable)
 	void OnPerceptTarget(APawn* Pawn);
 
-	/* Triggered by pawn sensing component when a pawn is spotted */
-	/* When using functions as delegates they need to be marked with UFUNCTION(). We assign this function to FSeePawnDelegate */
-	UFUNCTION()
-	void OnSeePlayer(APawn* Pawn);
-	
-	UFUNCTION()
-	void OnHearNoise(APawn* PawnInstigator, const FVector& Location, float Volume);
-
 	/* Deal damage to the Actor that was hit by the punch animation */
 	UFUNCTION(BlueprintCallable, Category = "Attacking")
 	void PerformMeleeStrike(AActor* HitActor);
@@ -98,6 +87,8 @@ protected:
 
 	virtual void PlayHit(float DamageTaken, struct FDamageEvent const& DamageEvent, APawn* PawnInstigator, AActor* DamageCauser, bool bKilled) override;
 
+	virtual void ApplyParkedState() override;
+
 public:
 
 	AShooterZombieCharacter(const class FObjectInitializer& ObjectInitializer);
@@ -116,4 +107,41 @@ public:
 
 	/* Change default bot type during gameplay */
 	void SetBotType(EBotBehaviorType NewType);
+
+	/* Forget sensed targets and restart sensing before the behavior tree restarts */
+	virtual void ResetFromPool(const FTransform& SpawnTransform) override;
+
+	/************************************************************************/
+	/* Sensing                                                              */
+	/************************************************************************/
+
+	/* Sight and hearing are evaluated for all zombies at once by the UShooterPerceptionManager */
+
+	/* Triggered by the perception manager when a player is spotted */
+	void OnSeePlayer(APawn* Pawn);
+
+	/* Triggered by the perception manager when a player noise is heard */
+	void OnHearNoise(APawn* PawnInstigator, const FVector& Location, float Volume);
+
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	float SightRadius;
+
+	/* Half angle of the vision cone in degrees */
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	float PeripheralVisionAngle;
+
+	/* Max distance a noise of loudness 1.0 is heard at, regardless of occlusion */
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	float HearingThreshold;
+
+	/* Max distance a noise of loudness 1.0 is heard at with line of sight to it */
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	float LOSHearingThreshold;
+
+	/* Seconds between two sensing updates at full significance */
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	float SensingInterval;
+
+	/* World time of the last sensing update */
+	float LastSenseTime;
 };
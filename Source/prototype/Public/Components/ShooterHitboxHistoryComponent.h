@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ShooterHitboxHistoryComponent.generated.h"
+
+
+class USkeletalMeshComponent;
+
+
+USTRUCT()
+struct FShooterHitboxDef
+{
+	GENERATED_BODY()
+
+	/* Bone the hitbox sphere is centered on */
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	FName BoneName;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	float Radius;
+
+	FShooterHitboxDef()
+		: BoneName(NAME_None),
+		  Radius(10.0f)
+	{}
+
+	FShooterHitboxDef(FName InBoneName, float InRadius)
+		: BoneName(InBoneName),
+		  Radius(InRadius)
+	{}
+};
+
+
+/* Result of a trace against rewound hitboxes */
+struct FShooterRewindHit
+{
+	int32 HitboxIndex;
+
+	FName BoneName;
+
+	FVector Location;
+
+	FShooterRewindHit()
+		: HitboxIndex(INDEX_NONE),
+		  BoneName(NAME_None),
+		  Location(FVector::ZeroVector)
+	{}
+};
+
+
+/**
+ * Server-side history of hitbox positions for lag compensation.
+ * Snapshots are kept in a fixed ring buffer as separate arrays (times, bounds, centers) so a rewind
+ * only touches the two snapshots around the requested time.
+ */
+UCLASS(ClassGroup=(PROTOTYPE), meta=(BlueprintSpawnableComponent))
+class PROTOTYPE_API UShooterHitboxHistoryComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UShooterHitboxHistoryComponent();
+
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/* Trace a segment against the hitboxes as they were at Timestamp (server world time). On a miss OutMissDistance is set to how far the segment passed the closest hitbox, or estimated from the bounds if it missed them. */
+	bool RewindLineTrace(float Timestamp, const FVector& TraceStart, const FVector& TraceEnd, float Leeway, FShooterRewindHit& OutHit, float* OutMissDistance = nullptr) const;
+
+	/* Check if any hitbox overlapped a sphere at Timestamp (server world time) */
+	bool RewindOverlapSphere(float Timestamp, const FVector& Center, float Radius) const;
+
+	/* Clamp a client provided timestamp to the recorded window */
+	float ClampRewindTimestamp(float ClientTimestamp) const;
+
+	/* Estimate the time the controller saw the world at from its ping */
+	float GetRewindTimestampFor(const AController* Controller) const;
+
+	/* Drop all snapshots and resume recording if this machine records, for owners that are reused from a pool */
+	void ResetHistory();
+
+protected:
+	virtual void BeginPlay() override;
+
+	UPROPERTY(EditDefaultsOnly, Category = "LagCompensation")
+	TArray<FShooterHitboxDef> Hitboxes;
+
+	/* How far back hits can be rewound (seconds) */
+	UPROPERTY(EditDefaultsOnly, Category = "LagCompensation")
+	float MaxRewindTime;
+
+	/* Minimum time between two snapshots, keeps high tick rates from shrinking the window */
+	UPROPERTY(EditDefaultsOnly, Category = "LagCompensation")
+	float SnapshotInterval;
+
+private:
+	void RecordSnapshot(float Timestamp);
+
+	/* Interpolate hitbox centers at Timestamp into OutCenters, returns the bounds of the pose */
+	FBox SampleAt(float Timestamp, FVector* OutCenters) const;
+
+	/* Live hitbox centers, used when no history has been recorded (standalone, just spawned) */
+	FBox SampleCurrent(FVector* OutCenters) const;
+
+	USkeletalMeshComponent* GetOwnerMesh() const;
+
+	int32 GetSnapshotSlot(int32 Age) const;
+
+	/* Ring buffer storage, indexed by slot */
+	TArray<float> SnapshotTimes;
+
+	TArray<FBox> SnapshotBounds;
+
+	/* Hitbox centers, Hitboxes.Num() entries per slot */
+	TArray<FVector> SnapshotCenters;
+
+	/* Resolved bone index per hitbox */
+	TArray<int32> BoneIndices;
+
+	/* Largest hitbox radius, used to inflate bounds for early outs */
+	float MaxHitboxRadius;
+
+	int32 Capacity;
+
+	/* Slot of the newest snapshot */
+	int32 HeadSlot;
+
+	int32 NumSnapshots;
+};
@@ -15,4 +15,8 @@ class PROTOTYPE_API UShooterMovementComponent : public UCharacterMovementCompone
 	GENERATED_BODY()
 	
 	virtual float GetMaxSpeed() const override;
+
+protected:
+	/* Keeps our entry in the pawn registry's spatial hash up to date */
+	virtual void OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity) override;
 };
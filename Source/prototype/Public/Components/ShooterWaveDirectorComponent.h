@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "EnvironmentQuery/EnvQueryTypes.h"
+#include "ShooterWaveDirectorComponent.generated.h"
+
+
+class UEnvQuery;
+class AShooterGameMode;
+
+
+DECLARE_DELEGATE(FOnWaveSpawningFinished);
+
+
+/**
+ * Spawns the bots of a wave for the owning game mode. Spawn locations come from asynchronous EQS queries
+ * (or the game mode's Blueprint fallback), spawning is spread over frames within a time budget and the wave
+ * size is scaled down when the server frame time goes over its target.
+ */
+UCLASS(ClassGroup=(PROTOTYPE), meta=(BlueprintSpawnableComponent))
+class PROTOTYPE_API UShooterWaveDirectorComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UShooterWaveDirectorComponent();
+
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/* Start spawning a wave, returns the number of bots after frame time scaling */
+	int32 StartWave(int32 RequestedBots);
+
+	/* Drop the remaining spawns of the current wave */
+	void StopWave();
+
+	bool IsSpawning() const
+	{
+		return NumPendingSpawns > 0;
+	}
+
+	int32 GetNumPendingSpawns() const
+	{
+		return NumPendingSpawns;
+	}
+
+	/* Called once all bots of the wave are spawned */
+	FOnWaveSpawningFinished OnWaveSpawningFinished;
+
+protected:
+	/* Finds spawn locations, run asynchronously. Without a query the game mode's FindBotSpawnTransform is used */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawning")
+	UEnvQuery* SpawnLocationQuery;
+
+	/* Time per frame spent on spawning bots, in microseconds. At least one bot is spawned per frame. */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawning", meta = (ClampMin = "0"))
+	int32 SpawnBudgetMicroseconds;
+
+	/* Minimum time between two spawn frames */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawning")
+	float SpawnInterval;
+
+	/* Server frame time the wave size is scaled against, in milliseconds */
+	UPROPERTY(EditDefaultsOnly, Category = "Scaling")
+	float TargetFrameTimeMs;
+
+	/* Smallest fraction of the requested wave size that is still spawned */
+	UPROPERTY(EditDefaultsOnly, Category = "Scaling", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float MinWaveScale;
+
+private:
+	void RequestSpawnLocations();
+
+	void OnSpawnQueryFinished(TSharedPtr<FEnvQueryResult> Result);
+
+	void SpawnBots();
+
+	/* Back off before asking for locations again, only the first failure in a row is logged */
+	void OnSpawnLocationsFailed(const TCHAR* Reason);
+
+	AShooterGameMode* GetGameMode() const;
+
+	/* Spawn locations waiting for a bot */
+	TArray<FTransform> SpawnTransforms;
+
+	int32 NumPendingSpawns;
+
+	/* EQS query currently running, INDEX_NONE if none */
+	int32 QueryId;
+
+	float LastSpawnTime;
+
+	/* No location requests before this world time after a failed one */
+	float NextLocationRequestTime;
+
+	int32 NumFailedLocationRequests;
+
+	/* Moving average of the game thread time in milliseconds */
+	float AverageFrameTimeMs;
+};
@@ -23,5 +23,14 @@ public:
 	TSubclassOf<class AShooterWeapon> WeaponClass;
 
 	virtual void OnUsed(APawn* InstigatorPawn) override;
+
+protected:
+
+	/* Dropped weapons only replicate movement while their physics body is awake */
+	UFUNCTION()
+	void OnMeshWake(UPrimitiveComponent* WakingComponent, FName BoneName);
+
+	UFUNCTION()
+	void OnMeshSleep(UPrimitiveComponent* SleepingComponent, FName BoneName);
 	
 };
@@ -9,6 +9,7 @@
 
 
 class UPawnNoiseEmitterComponent;
+class UShooterHitboxHistoryComponent;
 class USoundCue;
 class ADecalActor;
 class AShooterPowerupActor;
@@ -75,6 +76,15 @@ public:
 protected:
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void PossessedBy(AController* NewController) override;
+
+	virtual void OnRep_PlayerState() override;
+
+	/* Let the pawn registry know kind, team or alive state might have changed */
+	void UpdatePawnRegistry();
+
 	UPROPERTY(EditDefaultsOnly, Category = "Movement")
 	float SprintingSpeedModifier;
 
@@ -93,6 +103,10 @@ protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
 	UPawnNoiseEmitterComponent* NoiseEmitterComp;
 
+	/* Server-side hitbox history for lag compensated hit validation */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	UShooterHitboxHistoryComponent* HitboxHistoryComp;
+
 
 	/************************************************************************/
 	/* Damage & Death                                                       */
@@ -135,6 +149,49 @@ protected:
 
 	bool bDied;
 
+	/************************************************************************/
+	/* Pooling                                                              */
+	/************************************************************************/
+public:
+	/* Owned by the game mode's bot pool, parked after death instead of destroyed */
+	void SetPooled(bool bNewPooled);
+
+	bool IsPooled() const { return bPooled; }
+
+	/* Hide and deactivate until the pool hands us out again (server only) */
+	virtual void ParkInPool();
+
+	/* Bring a parked bot back to life at SpawnTransform (server only) */
+	virtual void ResetFromPool(const FTransform& SpawnTransform);
+
+protected:
+	/* Local part of parking, runs on server and clients */
+	virtual void ApplyParkedState();
+
+	/* Restores health, collision, mesh and movement to their defaults, runs on server and clients */
+	virtual void ApplyPooledReset();
+
+	/* Hands the corpse back to the game mode */
+	void ReturnToPool();
+
+	UPROPERTY(Transient, Replicated)
+	bool bPooled;
+
+	UPROPERTY(Transient, Replicated)
+	bool bInPool;
+
+	/* Bumped whenever the bot is parked or reused, clients apply the matching state */
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_PoolGeneration)
+	uint8 PoolGeneration;
+
+	UFUNCTION()
+	void OnRep_PoolGeneration();
+
+	/* Pool generation the last replicated hit belongs to, hits of a previous life are never merged */
+	uint8 LastTakeHitGeneration;
+
+	FTimerHandle TimerHandle_ReturnToPool;
+
 public:
 	// Power up
 	UPROPERTY(BlueprintReadWrite, Replicated)
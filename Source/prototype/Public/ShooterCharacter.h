@@ -190,6 +190,10 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Attacking")
 	float PunchDamage;
 
+	/* Max distance from our location to the target's hitboxes for a punch to be accepted */
+	UPROPERTY(EditDefaultsOnly, Category = "Attacking")
+	float PunchReach;
+
 public:
 	virtual FVector GetPawnViewLocation() const override;
 
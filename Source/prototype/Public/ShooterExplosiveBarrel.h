@@ -42,6 +42,13 @@ protected:
 	UFUNCTION()
 	void OnRep_Exploded();
 
+	/* Movement only replicates while the physics body is awake */
+	UFUNCTION()
+	void OnMeshWake(UPrimitiveComponent* WakingComponent, FName BoneName);
+
+	UFUNCTION()
+	void OnMeshSleep(UPrimitiveComponent* SleepingComponent, FName BoneName);
+
 	/* Impulse applied to the barrel mesh when it explodes to boost it up a little */
 	UPROPERTY(EditDefaultsOnly, Category = "FX")
 	float ExplosionImpulse;
@@ -10,22 +10,43 @@
 class USoundCue;
 
 
-UCLASS(ABSTRACT, Blueprintable)
-class PROTOTYPE_API AShooterImpactEffect : public AActor
+USTRUCT()
+struct FShooterSurfaceImpactFX
 {
 	GENERATED_BODY()
-	
-protected:
 
-	UParticleSystem* GetImpactFX(EPhysicalSurface SurfaceType) const;
+	UPROPERTY(EditDefaultsOnly)
+	TEnumAsByte<EPhysicalSurface> SurfaceType;
+
+	UPROPERTY(EditDefaultsOnly)
+	UParticleSystem* FX;
+
+	UPROPERTY(EditDefaultsOnly)
+	USoundCue* Sound;
+
+	FShooterSurfaceImpactFX()
+		: SurfaceType(SurfaceType_Default),
+		  FX(nullptr),
+		  Sound(nullptr)
+	{}
+};
 
-	USoundCue* GetImpactSound(EPhysicalSurface SurfaceType) const;
+
+/**
+ * Impact effect settings. Never spawned, the FX manager reads the class defaults
+ * and plays the effects from its pools.
+ */
+UCLASS(ABSTRACT, Blueprintable)
+class PROTOTYPE_API AShooterImpactEffect : public AActor
+{
+	GENERATED_BODY()
 
 public:
 
 	AShooterImpactEffect();
 
-	virtual void PostInitializeComponents() override;
+	/* Flatten the surface lookup into arrays indexed by surface type */
+	void BuildSurfaceTable(TArray<UParticleSystem*>& OutFX, TArray<USoundCue*>& OutSounds) const;
 
 	/* FX spawned on standard materials */
 	UPROPERTY(EditDefaultsOnly)
@@ -46,6 +67,10 @@ public:
 	UPROPERTY(EditDefaultsOnly)
 	USoundCue* ZombieFleshSound;
 
+	/* Per surface entries, take priority over the FX and sounds above */
+	UPROPERTY(EditDefaultsOnly)
+	TArray<FShooterSurfaceImpactFX> SurfaceOverrides;
+
 	UPROPERTY(EditDefaultsOnly, Category = "Decal")
 	UMaterial* DecalMaterial;
 
@@ -55,6 +80,4 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = "Decal")
 	float DecalLifeSpan;
 
-	FHitResult SurfaceHit;
-
 };
@@ -27,12 +27,74 @@ enum class EWeaponType
 };
 
 
+/* One trigger pull sent through the shot stream: the fire event and the hits it produced */
+USTRUCT()
+struct FShooterShotRecord
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint16 Sequence;
+
+	/* Server world time as seen by the client when the shot was fired */
+	UPROPERTY()
+	float Timestamp;
+
+	/* False when the trigger was pulled without a round being fired, lets the server start the reload */
+	UPROPERTY()
+	bool bFired;
+
+	UPROPERTY()
+	FShooterPelletHitBatch Hits;
+
+	FShooterShotRecord()
+		: Sequence(0),
+		  Timestamp(0.0f),
+		  bFired(false)
+	{}
+};
+
+
+/* Packet of the unreliable shot stream, oldest record first. Each packet repeats the last few unacknowledged shots. */
+USTRUCT()
+struct FShooterShotPacket
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FShooterShotRecord> Records;
+
+	/* Size of the packet on the wire, only set when received */
+	int32 SerializedBits;
+
+	FShooterShotPacket()
+		: SerializedBits(0)
+	{}
+
+	/* Records are delta compressed against the previous record in the packet */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FShooterShotPacket> : public TStructOpsTypeTraitsBase2<FShooterShotPacket>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+
 class USkeletalMeshComponent;
 class UDamageType;
 class UParticleSystem;
 class AShooterCharacter;
 class AShooterWeaponPickup;
 class USoundCue;
+class AShooterWeapon;
+
+
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnWeaponOwnerChanged, AShooterWeapon* /* Weapon */, AShooterCharacter* /* OldOwner */, AShooterCharacter* /* NewOwner */);
 
 
 UCLASS(ABSTRACT, Blueprintable)
@@ -44,6 +106,8 @@ class PROTOTYPE_API AShooterWeapon : public AActor
 
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
+	virtual void Tick(float DeltaSeconds) override;
+
 	float GetEquipStartedTime() const;
 
 	float GetEquipDuration() const;
@@ -58,8 +122,6 @@ class PROTOTYPE_API AShooterWeapon : public AActor
 
 	bool bPendingEquip;
 
-	FTimerHandle TimerHandle_HandleFiring;
-
 	FTimerHandle TimerHandle_EquipFinished;
 
 	FTimerHandle TimerHandle_UnEquipFinished;
@@ -126,6 +188,9 @@ public:
 	/* Set the weapon's owning pawn */
 	void SetOwningPawn(AShooterCharacter* NewOwner);
 
+	/* Broadcast on the server whenever a weapon changes hands, the replication graph keeps weapons as dependents of their owner */
+	static FOnWeaponOwnerChanged NotifyOwnerChanged;
+
 	/* Get pawn owner */
 	UFUNCTION(BlueprintCallable, Category = "Weapon")
 	AShooterCharacter* GetPawnOwner() const;
@@ -204,11 +269,6 @@ private:
 	void ServerStopFire_Implementation();
 	bool ServerStopFire_Validate();
 
-	UFUNCTION(Reliable, Server, WithValidation)
-	void ServerHandleFiring();
-	void ServerHandleFiring_Implementation();
-	bool ServerHandleFiring_Validate();
-
 	void OnBurstStarted();
 
 	void OnBurstFinished();
@@ -219,14 +279,114 @@ private:
 
 	bool bRefiring;
 
+	/* Time the last shot was due at, not the frame it was handled in */
 	float LastFireTime;
 
+	/* Fire scheduler: world time the next automatic shot is due at, several can fall into one frame */
+	float NextShotTime;
+
+	/* Cap on shots caught up in one frame after a hitch, the rest of the backlog is dropped */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
+	int32 MaxShotsPerFrame;
+
+	/* View direction at the end of the previous scheduler frame, shots in between interpolate from it */
+	FVector LastFrameAim;
+
+	/* Set while the scheduler fires a shot that was due earlier in the frame */
+	bool bUseScheduledAim;
+
+	FVector ScheduledAim;
+
+	/* Offset of the shot being fired from the current world time (<= 0) */
+	float ScheduledTimeOffset;
+
+	/* Fire all shots that became due since the last frame. Each is traced on its own, their records go out in one packet */
+	void RunFireScheduler(float DeltaSeconds);
+
+	/* Aim of the owner's view this frame, ignoring the scheduled aim */
+	FVector GetViewAim() const;
+
 	/* Time between shots for repeating fire */
 	UPROPERTY(Replicated)
 	float TimeBetweenShots;
 public:
 	void UpdateTimeBetweenShots();
 
+	/************************************************************************/
+	/* Shot Stream                                                          */
+	/************************************************************************/
+
+protected:
+	/* Shot being fired by the owning client, FireWeapon adds its hits here */
+	FShooterShotRecord PendingShot;
+
+	bool bRecordingShot;
+
+	/* Server side handling of the hits a client reported for a shot the server agreed was fired */
+	virtual void ServerProcessShotHits(const FShooterShotRecord& Record);
+
+	/* Server world time as seen by this machine */
+	float GetServerWorldTime() const;
+
+	/* Number of older unacknowledged shots repeated in each packet */
+	UPROPERTY(EditDefaultsOnly, Category = "Network")
+	int32 ShotRedundancy;
+
+	/* Interval to resend unacknowledged shots when no new shots are fired */
+	UPROPERTY(EditDefaultsOnly, Category = "Network")
+	float ShotResendInterval;
+
+private:
+	void BeginShotRecord();
+
+	void CommitShotRecord();
+
+	void SendShotPacket(bool bSendOldest);
+
+	/* Send the shots committed while batching in a single packet */
+	void FlushShotStream();
+
+	void ResendUnackedShots();
+
+	void ResetShotStream();
+
+	/* Returns false for shots that were already received or are too old to tell */
+	bool AcceptShotSequence(uint16 Sequence);
+
+	void UpdateShotAck();
+
+	void ProcessShotRecord(const FShooterShotRecord& Record);
+
+	UFUNCTION(Unreliable, Server, WithValidation)
+	void ServerShotStream(const FShooterShotPacket& Packet);
+	void ServerShotStream_Implementation(const FShooterShotPacket& Packet);
+	bool ServerShotStream_Validate(const FShooterShotPacket& Packet);
+
+	UFUNCTION()
+	void OnRep_ShotAck();
+
+	/* Client: sent shots waiting for an ack, oldest first */
+	TArray<FShooterShotRecord> UnackedShots;
+
+	uint16 NextShotSequence;
+
+	/* Committed shots are held back and sent together by FlushShotStream */
+	bool bBatchingShots;
+
+	/* Shots committed since the last packet was sent */
+	int32 NumNewShots;
+
+	FTimerHandle TimerHandle_ResendShots;
+
+	/* Server: newest received sequence and one bit per recent sequence (bit 0 is the newest) */
+	uint16 LastReceivedShotSequence;
+
+	uint64 ReceivedShotMask;
+
+	/* Every shot up to this sequence has been received or given up on */
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_ShotAck)
+	uint16 ShotAckSequence;
+
 	/************************************************************************/
 	/* Simulation & FX                                                      */
 	/************************************************************************/
@@ -4,8 +4,138 @@
 
 #include "CoreMinimal.h"
 #include "ShooterWeapon.h"
+#include "Net/Serialization/FastArraySerializer.h"
 #include "ShooterWeaponInstant.generated.h"
 
+
+class AShooterWeaponInstant;
+struct FShooterRewindHit;
+
+
+/* Outcome of validating a client reported hit on the server */
+enum class EShooterHitRegResult : uint8
+{
+	Accepted,
+
+	/* Static and stationary targets are accepted without a bounds check */
+	StaticAccepted,
+
+	RejectedViewDot,
+
+	RejectedBounds,
+
+	/* Shot origin too far from the server side muzzle and view location */
+	RejectedOrigin,
+
+	Num
+};
+
+
+/* Hit registration counters of one weapon, used to tune the validation settings */
+struct FShooterHitRegCounters
+{
+	/* Rejection distance histogram, see GetDistanceBucket for the bucket bounds */
+	static const int32 NumDistanceBuckets = 6;
+
+	uint32 Results[(int32)EShooterHitRegResult::Num];
+
+	uint32 RejectDistances[NumDistanceBuckets];
+
+	FShooterHitRegCounters()
+	{
+		FMemory::Memzero(Results);
+		FMemory::Memzero(RejectDistances);
+	}
+
+	static int32 GetDistanceBucket(float Distance);
+};
+
+
+/* Impact of a shot replicated to remote clients */
+USTRUCT()
+struct FShooterImpactEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize ImpactPoint;
+
+	/* Order the impacts happened in on the server, also makes hitting the same spot twice replicate */
+	UPROPERTY()
+	uint16 Sequence;
+
+	FShooterImpactEntry()
+		: ImpactPoint(FVector::ZeroVector),
+		  Sequence(0)
+	{}
+
+	void PostReplicatedAdd(const struct FShooterImpactRing& InArraySerializer);
+
+	void PostReplicatedChange(const struct FShooterImpactRing& InArraySerializer);
+};
+
+
+/**
+ * Fixed size ring of the latest impacts. The server overwrites the oldest slot, clients play every entry
+ * newer than the last one they played, in sequence order, once an update was received.
+ */
+USTRUCT()
+struct FShooterImpactRing : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FShooterImpactEntry> Items;
+
+	UPROPERTY(NotReplicated)
+	AShooterWeaponInstant* Owner;
+
+	/* Number of slots, more impacts than this in one net update are dropped oldest first */
+	static const int32 Capacity = 16;
+
+	FShooterImpactRing()
+		: Owner(nullptr),
+		  NextSlot(0),
+		  NextSequence(1),
+		  LastPlayedSequence(0),
+		  bHasPlayed(false)
+	{}
+
+	/* Server: add an impact, overwrites the oldest one when full */
+	void AddImpact(const FVector& ImpactPoint);
+
+	void PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FShooterImpactEntry, FShooterImpactRing>(Items, DeltaParms, *this);
+	}
+
+private:
+	friend struct FShooterImpactEntry;
+
+	/* Server: slot to overwrite once the ring is full */
+	int32 NextSlot;
+
+	uint16 NextSequence;
+
+	/* Client: entries received in the current update that still need to be played */
+	TArray<int32, TInlineAllocator<Capacity>> ReceivedIndices;
+
+	uint16 LastPlayedSequence;
+
+	bool bHasPlayed;
+};
+
+template<>
+struct TStructOpsTypeTraits<FShooterImpactRing> : public TStructOpsTypeTraitsBase2<FShooterImpactRing>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true
+	};
+};
+
 /**
  * 
  */
@@ -14,6 +144,8 @@ class PROTOTYPE_API AShooterWeaponInstant : public AShooterWeapon
 {
 	GENERATED_BODY()
 
+	friend struct FShooterImpactRing;
+
 private:
 
 	/************************************************************************/
@@ -22,6 +154,14 @@ private:
 
 	void SimulateInstantHit(const FVector& ImpactPoint);
 
+	/* Cosmetic retrace for remote shots finished, runs at the start of the next frame */
+	void OnCosmeticTraceCompleted(const FTraceHandle& Handle, FTraceDatum& Data);
+
+	/* Place impact and trail FX for a retraced shot */
+	void SpawnHitEffects(const FHitResult& Impact, const FVector& EndTrace);
+
+	FTraceDelegate CosmeticTraceDelegate;
+
 	void SpawnImpactEffects(const FHitResult& Impact);
 
 	void SpawnTrailEffects(const FVector& EndPoint);
@@ -46,6 +186,14 @@ private:
 	UPROPERTY(EditDefaultsOnly)
 	int32 TracerRoundInterval;
 
+	/* Pooled tracer and trail components per weapon class, oldest is reused when all are playing */
+	UPROPERTY(EditDefaultsOnly)
+	int32 TrailPoolSize;
+
+	/* Trails of other players beyond this distance or off screen are skipped */
+	UPROPERTY(EditDefaultsOnly)
+	float MaxTrailDrawDistance;
+
 	/* Keeps track of number of shots fired */
 	int32 BulletsShotCount;
 
@@ -53,6 +201,8 @@ protected:
 
 	AShooterWeaponInstant();
 
+	virtual void BeginPlay() override;
+
 	/************************************************************************/
 	/* Damage Processing                                                    */
 	/************************************************************************/
@@ -61,27 +211,74 @@ protected:
 
 	void DealDamage(const FHitResult& Impact, const FVector& ShootDir);
 
+	/* Damage of a single hit including surface modifiers */
+	float GetHitDamage(const FHitResult& Impact) const;
+
+	void ApplyHitDamage(const FHitResult& Impact, const FVector& ShootDir, float Damage);
+
 	bool ShouldDealDamage(AActor* TestActor) const;
 
 	void ProcessInstantHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir);
 
 	void ProcessInstantHitConfirmed(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir);
 
-	UFUNCTION(Reliable, Server, WithValidation)
-	void ServerNotifyHit(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir);
-	void ServerNotifyHit_Implementation(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir);
-	bool ServerNotifyHit_Validate(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir);
+	/* Hits reported by the owning client through the shot stream */
+	virtual void ServerProcessShotHits(const FShooterShotRecord& Record) override;
+
+	/**
+	 * Check a client hit against the target as it was at ClientTimestamp, OutRejectDistance is how far off a rejected hit was.
+	 * The line is rebuilt from Origin, which must come from the server, towards the claimed impact point. OutRewindHit is
+	 * the hitbox the line touched first, it has no hitbox for actors without a hitbox history.
+	 */
+	bool ServerValidateRewindHit(const FHitResult& Impact, const FVector& Origin, float ClientTimestamp, FShooterRewindHit& OutRewindHit, float& OutRejectDistance) const;
+
+	/* Check the origin a client reported for a shot, OutOrigin is the server side muzzle location to use instead */
+	bool ServerValidateShotOrigin(const FVector& ClientOrigin, FVector& OutOrigin) const;
 
-	UFUNCTION(Reliable, Server, WithValidation)
-	void ServerNotifyMiss(FVector_NetQuantizeNormal ShootDir);
-	void ServerNotifyMiss_Implementation(FVector_NetQuantizeNormal ShootDir);
-	bool ServerNotifyMiss_Validate(FVector_NetQuantizeNormal ShootDir);
+	/* Count a validation result for this weapon and the frame totals, no allocations */
+	void RecordHitReg(EShooterHitRegResult Result, float RejectDistance = 0.0f);
 
-	UPROPERTY(Transient, ReplicatedUsing = OnRep_HitLocation)
-	FVector HitImpactNotify;
+	FShooterHitRegCounters HitRegCounters;
 
-	UFUNCTION()
-	void OnRep_HitLocation();
+public:
+	const FShooterHitRegCounters& GetHitRegCounters() const
+	{
+		return HitRegCounters;
+	}
+
+protected:
+
+	/* Impacts for remote clients to play, the owner simulates its own shots */
+	UPROPERTY(Transient, Replicated)
+	FShooterImpactRing ReplicatedImpacts;
+
+	/************************************************************************/
+	/* Pellets                                                              */
+	/************************************************************************/
+
+	/* Trace all pellets of a shot in one pass and report them as a single batch */
+	void FirePellets();
+
+	void ProcessPelletHits(const FShooterPelletHitBatch& Batch);
+
+	/* Validate (server only) and apply all pellet hits of a shot, damage is summed per actor */
+	void ProcessPelletHitsConfirmed(const FShooterPelletHitBatch& Batch, bool bValidate, float ClientTimestamp);
+
+	/* Rebuild the hit result of a pellet from its compact form */
+	bool BuildPelletImpact(const FShooterPelletHit& Hit, const FVector& Origin, FHitResult& OutImpact) const;
+
+	/* Set component, bone and physical material of Impact from a bone of the hit actor's skeletal mesh */
+	void SetImpactBone(FHitResult& Impact, FName BoneName) const;
+
+	static FShooterPelletHit MakePelletHit(const FHitResult& Impact);
+
+	/* Number of traces per shot, more than one turns this into a shotgun */
+	UPROPERTY(EditDefaultsOnly)
+	int32 PelletCount;
+
+	/* Full cone angle in degrees the pellets are spread over */
+	UPROPERTY(EditDefaultsOnly)
+	float PelletSpread;
 
 	/************************************************************************/
 	/* Weapon Configuration                                                 */
@@ -93,6 +290,9 @@ protected:
 	UPROPERTY(EditDefaultsOnly)
 	TSubclassOf<class UDamageType> DamageType;
 
+	/* Row of DamageType in the damage profile table, resolved in BeginPlay */
+	int32 DamageProfileIndex;
+
 	UPROPERTY(EditDefaultsOnly)
 	float WeaponRange;
 
@@ -100,8 +300,16 @@ protected:
 	UPROPERTY(EditDefaultsOnly)
 	float AllowedViewDotHitDir;
 
-	/* Hit verification: scale for bounding box of hit actor */
+	/* Hit verification: scale for bounding box of hit actor, used for targets without hitbox history */
 	UPROPERTY(EditDefaultsOnly)
 	float ClientSideHitLeeway;
+
+	/* Hit verification: distance added to rewound hitboxes */
+	UPROPERTY(EditDefaultsOnly)
+	float RewindHitLeeway;
+
+	/* Hit verification: max distance between the shot origin a client reports and the server side muzzle or view location */
+	UPROPERTY(EditDefaultsOnly)
+	float MaxShotOriginError;
 	
 };
@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ShooterAISignificanceManager.generated.h"
+
+
+class APawn;
+
+
+UENUM()
+enum class EShooterAITickTier : uint8
+{
+	/* Close to or in view of a player */
+	Full,
+
+	/* Brain, path following and sensing at a reduced rate */
+	Reduced,
+
+	/* Far from every player, movement and brain only update a few times per second */
+	Dormant,
+
+	Num UMETA(Hidden)
+};
+
+
+/* Tier of a tracked bot */
+struct FShooterAISignificance
+{
+	EShooterAITickTier Tier;
+
+	/* Significance pass that last saw the bot alive */
+	int32 LastUpdate;
+};
+
+
+/**
+ * Scores living bots by distance to the nearest hostile player, weighted by whether they are in that player's view,
+ * and moves them between tick tiers. A tier sets the actor tick interval, the tick interval of the path following and
+ * behavior tree components, and scales the perception interval. Movement and mesh are only stepped for dormant bots on
+ * dedicated servers, hits on those get extra rewind leeway. Bots are restored to full rate when they die or unregister.
+ */
+UCLASS()
+class PROTOTYPE_API UShooterAISignificanceManager : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UShooterAISignificanceManager();
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	virtual void Deinitialize() override;
+
+	/* FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+
+	virtual ETickableTickType GetTickableTickType() const override;
+
+	virtual bool IsTickable() const override;
+
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	virtual TStatId GetStatId() const override;
+
+	/* Full for bots that are not tracked */
+	EShooterAITickTier GetTier(APawn* Bot) const;
+
+	/* Multiplier of the sensing interval of Bot at its current tier */
+	float GetSensingIntervalScale(APawn* Bot) const;
+
+	/* Distance the recorded hitboxes of Bot can be off by because its movement is stepped at its current tier */
+	float GetExtraRewindLeeway(APawn* Bot) const;
+
+private:
+
+	void UpdateSignificance();
+
+	/* Tier from the distance to the nearest viewer, demotions use slightly larger distances than promotions */
+	EShooterAITickTier ScoreBot(const APawn* Bot, EShooterAITickTier CurrentTier) const;
+
+	static void ApplyTier(APawn* Bot, EShooterAITickTier Tier);
+
+	TMap<TWeakObjectPtr<APawn>, FShooterAISignificance> Bots;
+
+	/* Living human players of the current pass */
+	TArray<FVector> ViewerLocations;
+
+	TArray<FVector> ViewerDirections;
+
+	int32 UpdateCount;
+
+	float TimeUntilUpdate;
+};
@@ -8,6 +8,8 @@
 
 
 enum class EWaveState : uint8;
+enum class EShooterPawnKind : uint8;
+class UShooterWaveDirectorComponent;
 
 /**
  * 
@@ -57,15 +59,14 @@ protected:
 
 	FTimerHandle TimerHandle_GameStart;
 
-	FTimerHandle TimerHandle_BotSpawner;
+	/* Spawns the bots of the current wave */
+	UPROPERTY(VisibleAnywhere, Category = "Components")
+	UShooterWaveDirectorComponent* WaveDirector;
 
 	FTimerHandle TimerHandle_PrepareForNextWaveStart;
 
 	FTimerHandle TimerHandle_OneWaveMaxDuration;
 
-	// Bots to spawn in current wave
-	int32 NrOfBotsToSpawn;
-
 	UPROPERTY(EditDefaultsOnly, Category = "Rules")
 	int32 MaxWaveCount;
 
@@ -82,8 +83,6 @@ protected:
 
 protected:
 
-	void SpawnBotTimerElapsed();
-
 	// Start Spawning Bots
 	void StartWave();
 
@@ -95,6 +94,14 @@ protected:
 
 	void CheckWaveState();
 
+	/* Director spawned the whole wave, the remaining bots may already be dead */
+	void OnWaveSpawningFinished();
+
+	/* Keeps the replicated bot count current and completes the wave when the last bot died */
+	void OnAlivePawnCountChanged(EShooterPawnKind Kind, int32 NumAlive);
+
+	virtual void BeginPlay() override;
+
 	void GameOver();
 
 	void SetWaveState(EWaveState NewState);
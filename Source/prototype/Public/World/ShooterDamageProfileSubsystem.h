@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "ShooterDamageProfileSubsystem.generated.h"
+
+
+class UDamageType;
+
+
+/**
+ * Damage type settings flattened into one table, a row per damage type with the final multiplier for every physical surface.
+ * Rows for all loaded UShooterDamageType classes are built on startup, classes loaded later are added on first use.
+ * Damage sources resolve their row once and a hit costs a single array lookup.
+ */
+UCLASS()
+class PROTOTYPE_API UShooterDamageProfileSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	static UShooterDamageProfileSubsystem* Get(const UObject* WorldContextObject);
+
+	/* Row of the damage type, the default row (no modifiers, can die) for null or non shooter damage types */
+	int32 GetProfileIndex(TSubclassOf<UDamageType> DamageTypeClass);
+
+	FORCEINLINE float GetMultiplier(int32 ProfileIndex, EPhysicalSurface SurfaceType) const
+	{
+		return Multipliers[ProfileIndex * SurfaceType_Max + SurfaceType];
+	}
+
+	FORCEINLINE bool CanDieFrom(int32 ProfileIndex) const
+	{
+		return CanDieFlags[ProfileIndex];
+	}
+
+	/* Row 0 is used for damage without a shooter damage type */
+	static const int32 DefaultProfileIndex = 0;
+
+private:
+	int32 AddProfile(UClass* DamageTypeClass);
+
+	UPROPERTY(Transient)
+	TMap<UClass*, int32> ProfileIndices;
+
+	/* SurfaceType_Max entries per row */
+	TArray<float> Multipliers;
+
+	TArray<bool> CanDieFlags;
+};
@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterFXManager.generated.h"
+
+
+class AShooterImpactEffect;
+class UParticleSystem;
+class UParticleSystemComponent;
+class UDecalComponent;
+class USoundCue;
+
+
+/* Impact settings of one AShooterImpactEffect class, flattened for lookups by surface type */
+USTRUCT()
+struct FShooterImpactFXTable
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<UParticleSystem*> FX;
+
+	UPROPERTY()
+	TArray<USoundCue*> Sounds;
+
+	UPROPERTY()
+	UMaterialInterface* DecalMaterial;
+
+	UPROPERTY()
+	float DecalSize;
+
+	UPROPERTY()
+	float DecalLifeSpan;
+
+	FShooterImpactFXTable()
+		: DecalMaterial(nullptr),
+		  DecalSize(0.0f),
+		  DecalLifeSpan(0.0f)
+	{}
+};
+
+
+/* Tracer and trail components of one weapon class */
+USTRUCT()
+struct FShooterTrailPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> Tracers;
+
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> Trails;
+
+	/* World time each component was last activated at */
+	TArray<float> TracerUseTimes;
+
+	TArray<float> TrailUseTimes;
+};
+
+
+/**
+ * World level pool for cosmetic hit effects. Emitters and decals are created once and recycled, finished
+ * ones first and the least recently used one otherwise, with a cap on how many impacts start per frame.
+ * Tracers and trails use a separate pool per weapon class. Not created on dedicated servers.
+ */
+UCLASS()
+class PROTOTYPE_API UShooterFXManager : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UShooterFXManager();
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	virtual void Deinitialize() override;
+
+	/* Create the pooled components up front, safe to call more than once */
+	void Prewarm();
+
+	/* Play emitter, sound and decal for a blocking hit */
+	void SpawnImpactEffects(TSubclassOf<AShooterImpactEffect> ImpactTemplate, const FHitResult& Impact);
+
+	/* Play a tracer (bTracer) or trail from the ring pool of WeaponClass. PoolSize is used when the pool is created. */
+	void SpawnTrail(UClass* WeaponClass, int32 PoolSize, bool bTracer, UParticleSystem* FX, const FVector& Origin, const FVector& EndPoint, FName TargetParam);
+
+	/* Distance and frustum check against the local player's camera */
+	bool IsTrailVisible(const FVector& Origin, const FVector& EndPoint, float MaxDrawDistance) const;
+
+private:
+	const FShooterImpactFXTable& GetImpactTable(TSubclassOf<AShooterImpactEffect> ImpactTemplate);
+
+	/* Per frame spawn budget, returns false if this frame already used it up */
+	bool ConsumeSpawnBudget();
+
+	UParticleSystemComponent* CreatePooledEmitter();
+
+	/* First inactive emitter of the pool, or the least recently used one if all are playing */
+	UParticleSystemComponent* AcquireEmitter(const TArray<UParticleSystemComponent*>& Components, TArray<float>& UseTimes);
+
+	void SpawnDecal(const FShooterImpactFXTable& Table, const FHitResult& Impact);
+
+	/* Hidden decal if there is one, otherwise the oldest. Expired decals are hidden on the way */
+	int32 AcquireDecal();
+
+	UPROPERTY(Transient)
+	TMap<UClass*, FShooterImpactFXTable> ImpactTables;
+
+	UPROPERTY(Transient)
+	TArray<UParticleSystemComponent*> ImpactEmitters;
+
+	UPROPERTY(Transient)
+	TArray<UDecalComponent*> Decals;
+
+	UPROPERTY(Transient)
+	TMap<UClass*, FShooterTrailPool> TrailPools;
+
+	/* World time each impact emitter was last activated at */
+	TArray<float> EmitterUseTimes;
+
+	/* World time each decal was placed at */
+	TArray<float> DecalUseTimes;
+
+	/* World time each decal expires at, hidden decals are 0 */
+	TArray<float> DecalExpireTimes;
+
+	uint64 BudgetFrame;
+
+	int32 SpawnsThisFrame;
+};
@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Async/Future.h"
+#include "ShooterFlowFieldManager.generated.h"
+
+
+/* Walkable cells sampled from the navmesh, immutable once built so worker threads can read it */
+struct FShooterFlowGrid
+{
+	FVector2D Origin;
+
+	float CellSize;
+
+	int32 SizeX;
+
+	int32 SizeY;
+
+	/* Navmesh height of each walkable cell */
+	TArray<float> Heights;
+
+	TBitArray<> Walkable;
+
+	/* One bit per neighbour (see FlowNeighbourOffsets) that can be reached directly */
+	TArray<uint8> Links;
+
+	int32 GetCellIndex(const FVector& Location) const;
+
+	FVector GetCellLocation(int32 CellIdx) const;
+};
+
+
+/* Distance field towards one target cell, each cell stores the neighbour to step to */
+struct FShooterFlowField
+{
+	int32 TargetCell;
+
+	/* Neighbour index per cell, INDEX_NONE (0xFF) if the target can't be reached or this is the target cell */
+	TArray<uint8> Directions;
+};
+
+
+typedef TSharedPtr<const FShooterFlowGrid, ESPMode::ThreadSafe> FShooterFlowGridPtr;
+typedef TSharedPtr<const FShooterFlowField, ESPMode::ThreadSafe> FShooterFlowFieldPtr;
+
+
+/* Field of one target player, the previous field stays readable while the next is computed */
+struct FShooterFlowFieldTarget
+{
+	TWeakObjectPtr<AActor> Target;
+
+	FShooterFlowFieldPtr Field;
+
+	TFuture<FShooterFlowFieldPtr> PendingField;
+
+	float LastQueryTime;
+
+	float LastBuildTime;
+};
+
+
+/**
+ * Flow fields over a grid sampled from the navmesh, one per target player. The grid is built once, time sliced on
+ * the game thread. Fields are recomputed on a worker thread whenever the target enters a new cell, agents read the
+ * next point to steer to with a single lookup, so any number of bots chasing the same player share one search.
+ * The grid keeps one navmesh layer per cell, overlapping floors resolve to the layer closest to the cell center.
+ */
+UCLASS()
+class PROTOTYPE_API UShooterFlowFieldManager : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UShooterFlowFieldManager();
+
+	virtual void Deinitialize() override;
+
+	/* FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+
+	virtual ETickableTickType GetTickableTickType() const override;
+
+	virtual bool IsTickable() const override;
+
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	virtual TStatId GetStatId() const override;
+
+	/**
+	 * Center of the next cell along the field from Location towards Target that is at least MinDistance away.
+	 * Returns false while the grid or field is still being built or Location is off the grid, callers fall back
+	 * to regular pathing. Starts tracking Target.
+	 */
+	bool GetNextFlowPoint(AActor* Target, const FVector& Location, float MinDistance, FVector& OutPoint);
+
+private:
+
+	/* Sample a slice of the navmesh, returns true once the grid is complete */
+	bool BuildGridSlice();
+
+	void UpdateTargets(float WorldTime);
+
+	static FShooterFlowFieldPtr ComputeField(FShooterFlowGridPtr FlowGrid, int32 TargetCell);
+
+	/* Grid under construction, moved to Grid when complete */
+	TSharedPtr<FShooterFlowGrid, ESPMode::ThreadSafe> PendingGrid;
+
+	FShooterFlowGridPtr Grid;
+
+	/* Next cell to sample, continues with the links once all cells are sampled */
+	int32 BuildCursor;
+
+	/* Vertical range of the navmesh, cells are projected within it */
+	float BuildZCenter;
+
+	float BuildZExtent;
+
+	bool bGridRequested;
+
+	TArray<FShooterFlowFieldTarget> Targets;
+};
@@ -21,6 +21,48 @@ struct FBotPawnInfo
 };
 
 
+/* Dead bots of one class waiting to be reused */
+USTRUCT()
+struct FShooterBotPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<class AShooterBaseCharacter*> ParkedBots;
+
+	/* Bots of this class created for the pool so far */
+	int32 NumCreated;
+
+	FShooterBotPool()
+		: NumCreated(0)
+	{}
+};
+
+
+/* Player start with its capsule extents, cached when the game is initialized */
+USTRUCT()
+struct FShooterSpawnPoint
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	APlayerStart* PlayerStart;
+
+	FVector Location;
+
+	float Radius;
+
+	float HalfHeight;
+
+	FShooterSpawnPoint()
+		: PlayerStart(nullptr),
+		  Location(ForceInitToZero),
+		  Radius(0.0f),
+		  HalfHeight(0.0f)
+	{}
+};
+
+
 class AShooterPlayerState;
 class APlayerStart;
 
@@ -43,6 +85,11 @@ protected:
 
 	virtual void StartMatch() override;
 
+	/* Start and stop the game state's clock */
+	virtual void HandleMatchHasStarted() override;
+
+	virtual void HandleMatchHasEnded() override;
+
 	virtual void OnWaveEnded();
 
 	virtual void SpawnDefaultInventory(APawn* PlayerPawn);
@@ -102,9 +149,23 @@ protected:
 	/* Always pick a random location */
 	virtual bool ShouldSpawnAtStartSpot(AController* Player) override;
 
-	virtual bool IsSpawnpointAllowed(APlayerStart* SpawnPoint, AController* Controller);
+	/* Collects and splits the player starts of the level, runs once in InitGame */
+	void BuildSpawnPointIndex();
+
+	/* Shooter player starts flagged player only, preferred by human players when not occupied */
+	UPROPERTY(Transient)
+	TArray<FShooterSpawnPoint> PlayerOnlySpawnPoints;
 
-	virtual bool IsSpawnpointPreferred(APlayerStart* SpawnPoint, AController* Controller);
+	/* Base class player starts, anyone can spawn here */
+	UPROPERTY(Transient)
+	TArray<FShooterSpawnPoint> SharedSpawnPoints;
+
+	/* Shooter player starts without the player only flag, only used for controllers without a playerstate */
+	UPROPERTY(Transient)
+	TArray<FShooterSpawnPoint> RestrictedSpawnPoints;
+
+	/* Is the spawn point blocked by a living pawn */
+	bool IsSpawnPointOccupied(const FShooterSpawnPoint& SpawnPoint) const;
 
 	/** returns default pawn class for given controller */
 	virtual UClass* GetDefaultPawnClassForController_Implementation(AController* InController) override;
@@ -134,16 +195,58 @@ protected:
 	UFUNCTION(BlueprintCallable, Exec, Category = "GameMode")
 	void SpawnNewBot();
 
+public:
 	/* Blueprint hook to find a good spawn location for BOTS (Eg. via EQS queries) */
 	UFUNCTION(BlueprintImplementableEvent, Category = "GameMode")
 	bool FindBotSpawnTransform(FTransform& Transform);
 
+	/* Spawn a bot of a random class from BotPawnInfos, weighted by probability */
+	APawn* SpawnBotAt(const FTransform& SpawnTransform);
+
+protected:
+
 	/* Set all bots back to idle mode */
 	void PassifyAllBots();
 
 	/* Set all bots to active patrolling state */
 	void WakeAllBots();
 
+	/* Reuses a parked bot of the class if there is one, spawns a new pawn otherwise */
+	APawn* SpawnBotFromPool(TSubclassOf<APawn> BotPawnClass, const FTransform& SpawnTransform);
+
+	/* Fill the bot pools over Duration seconds, one bot per timer tick */
+	void StartBotPoolPrewarm(float Duration);
+
+	void PrewarmNextBot();
+
+	/* Logs spawn latency of the bots spawned since the last report */
+	void ReportBotSpawnLatency(int32 WaveNumber);
+
+	/* Bots to keep per pooled class, only classes derived from AShooterBaseCharacter are pooled */
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	int32 BotPoolSize;
+
+	UPROPERTY(Transient)
+	TMap<UClass*, FShooterBotPool> BotPools;
+
+	FTimerHandle TimerHandle_BotPoolPrewarm;
+
+	/* Prewarm ticks in a row without a spawn location */
+	int32 NumBotPoolPrewarmFailures;
+
+	/* Spawn latency since the last report */
+	uint32 SpawnLatencyCycles;
+
+	uint32 MaxSpawnLatencyCycles;
+
+	int32 NumBotsSpawned;
+
+	int32 NumBotsReused;
+
+public:
+	/* Pooled bots return here once their corpse timed out */
+	void ReturnBotToPool(class AShooterBaseCharacter* Bot);
+
 public:
 	/* Primary sun of the level. Assigned in Blueprint during BeginPlay (BlueprintReadWrite is required as tag instead of EditDefaultsOnly) */
 	UPROPERTY(BlueprintReadWrite, Category = "DayNight")
@@ -23,6 +23,81 @@ enum class EWaveState : uint8
 };
 
 
+/* Wave progress, replicated as one struct so a wave change costs a single small property update */
+USTRUCT(BlueprintType)
+struct FShooterWaveInfo
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Wave")
+	EWaveState State;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Wave")
+	int32 WaveCount;
+
+	/* Game time in seconds the next wave starts at */
+	UPROPERTY(BlueprintReadOnly, Category = "Wave")
+	int32 NextWaveStartTime;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Wave")
+	int32 NumBotsAlive;
+
+	FShooterWaveInfo()
+		: State(EWaveState::WaitingToStart),
+		  WaveCount(0),
+		  NextWaveStartTime(0),
+		  NumBotsAlive(0)
+	{}
+
+	/* State in 3 bits, counters as packed ints */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FShooterWaveInfo> : public TStructOpsTypeTraitsBase2<FShooterWaveInfo>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+
+/* Anchor of the game clock, clients extrapolate the elapsed game time from synchronized server time */
+USTRUCT()
+struct FShooterMatchClock
+{
+	GENERATED_BODY()
+
+	/* Server world time the clock was (re)started at */
+	UPROPERTY()
+	float StartWorldTime;
+
+	/* Game seconds on the clock at StartWorldTime */
+	UPROPERTY()
+	float StartGameSeconds;
+
+	/* Game seconds per second of world time */
+	UPROPERTY()
+	float TimeScale;
+
+	UPROPERTY()
+	bool bRunning;
+
+	FShooterMatchClock()
+		: StartWorldTime(0.0f),
+		  StartGameSeconds(0.0f),
+		  TimeScale(1.0f),
+		  bRunning(false)
+	{}
+
+	float GetGameSeconds(float WorldTime) const
+	{
+		return bRunning ? StartGameSeconds + FMath::Max(WorldTime - StartWorldTime, 0.0f) * TimeScale : StartGameSeconds;
+	}
+};
+
+
 enum class EHUDMessage : uint8;
 
 /**
@@ -45,29 +120,34 @@ public:
 
 	AShooterGameState();
 
-	UPROPERTY(Replicated)
-	int32 NextWaveStartTime;
+	/* Current time of day in the gamemode, computed locally from the replicated clock */
+	UFUNCTION(BlueprintCallable, Category = "TimeOfDay")
+	float GetElapsedGameSeconds() const;
 
-	/* Current time of day in the gamemode represented in full minutes */
-	UPROPERTY(BlueprintReadOnly, Replicated, Category = "TimeOfDay")
-	int32 ElapsedGameSeconds;
+	/* Whole seconds as before, impure so existing Blueprint nodes keep their exec pins */
+	UFUNCTION(BlueprintCallable, Category = "TimeOfDay", meta = (BlueprintPure = false))
+	int32 GetNextWaveRemainingTime() const;
 
+	/* Unrounded remaining time, for smooth timers */
 	UFUNCTION(BlueprintCallable, Category = "TimeOfDay")
-	int32 GetNextWaveRemainingTime();
+	float GetNextWaveRemainingSeconds() const;
 
 	/* Conversion of 1 second real time to X seconds gametime */
 	UPROPERTY(EditDefaultsOnly, Category = "TimeOfDay")
 	float TimeScale;
 
-	float GetTimeOfSecondIncrement() const;
+	/* Run the clock while the match is in progress (server only) */
+	void StartMatchClock();
 
-	UFUNCTION(BlueprintCallable, Category = "TimeOfDay")
-	int32 GetElapsedMinutes();
+	void StopMatchClock();
 
-	UFUNCTION(BlueprintCallable, Category = "TimeOfDay")
-	int32 GetElapsedFullMinutesInSeconds();
+	UFUNCTION(BlueprintCallable, Category = "TimeOfDay", meta = (BlueprintPure = false))
+	int32 GetElapsedMinutes() const;
 
-	int32 GetElapsedSecondsCurrentMinute();
+	UFUNCTION(BlueprintCallable, Category = "TimeOfDay", meta = (BlueprintPure = false))
+	int32 GetElapsedFullMinutesInSeconds() const;
+
+	int32 GetElapsedSecondsCurrentMinute() const;
 
 	/* By passing in "exec" we expose it as a command line (press ~ to open) */
 	UFUNCTION(exec)
@@ -85,24 +165,43 @@ public:
 	virtual void RemovePlayerState(APlayerState* PlayerState) override;
 protected:
 	UFUNCTION()
-	void OnRep_WaveState(EWaveState OldState);
+	void OnRep_WaveInfo(const FShooterWaveInfo& OldInfo);
 
 	void WaveStateChanged(EWaveState NewState, EWaveState OldState);
 
-	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_WaveState, Category = "GameState")
-	EWaveState WaveState;
+	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_WaveInfo, Category = "GameState")
+	FShooterWaveInfo WaveInfo;
 
+	/* Only changes when the clock starts, stops or is set, never per second */
 	UPROPERTY(Replicated)
-	int32 WaveCount;
+	FShooterMatchClock MatchClock;
 
 public:
 	void SetWaveCount(int32 NewWaveCount);
 
 	UFUNCTION(BlueprintCallable)
-	int32 GetWaveCount() const { return WaveCount; };
+	int32 GetWaveCount() const { return WaveInfo.WaveCount; };
 
 	void SetWaveState(EWaveState NewState);
 
+	EWaveState GetWaveState() const { return WaveInfo.State; }
+
+	void SetNextWaveStartTime(int32 NewStartTime);
+
+	int32 GetNextWaveStartTime() const { return WaveInfo.NextWaveStartTime; }
+
+	void SetNumBotsAlive(int32 NewNumBotsAlive);
+
+	UFUNCTION(BlueprintCallable)
+	int32 GetNumBotsAlive() const { return WaveInfo.NumBotsAlive; }
+
+	void SetVIPHealth(int32 NewHealth);
+
+	void SetPlayerRespawnCount(int32 NewCount);
+
+	void SetGameIsWin(bool bNewIsWin);
+
+	/* Properties are push based, write them through the setters above so they get marked dirty */
 	UPROPERTY(BlueprintReadOnly, Replicated)
 	int32 VIPHealth;
 
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "NavigationData.h"
+#include "ShooterPathCache.generated.h"
+
+
+/* A finished path towards a goal actor, shared by every bot that can join it */
+struct FShooterSharedPath
+{
+	TArray<FVector> Points;
+
+	/* Goal location the path was built for, the path goes stale once the goal moved away from it */
+	FVector GoalLocation;
+
+	float TimeStamp;
+};
+
+
+/* Path query waiting for budget (QueryId 0) or running on the navigation system */
+struct FShooterPathRequest
+{
+	TWeakObjectPtr<AActor> Goal;
+
+	FVector Start;
+
+	uint32 QueryId;
+};
+
+
+/**
+ * Async path queries with a per frame budget. Paths are cached per goal actor and shared, a bot close enough to
+ * a cached path towards the same goal follows it instead of starting a query of its own. Callers poll
+ * FindNextPathPoint and keep their previous point while the query is in flight.
+ */
+UCLASS()
+class PROTOTYPE_API UShooterPathCache : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/* FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+
+	virtual ETickableTickType GetTickableTickType() const override;
+
+	virtual bool IsTickable() const override;
+
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	virtual TStatId GetStatId() const override;
+
+	/**
+	 * Next point to steer to from Location towards Goal, skipping points within AcceptRadius. Returns false when no
+	 * usable path is cached yet, a query is then queued unless a nearby one is already pending.
+	 */
+	bool FindNextPathPoint(const FVector& Location, AActor* Goal, float AcceptRadius, FVector& OutPoint);
+
+private:
+
+	/* Index of the closest path segment end within JoinRadius of Location, INDEX_NONE if too far away */
+	static int32 FindJoinIndex(const FShooterSharedPath& Path, const FVector& Location);
+
+	/* Feet location for pawns, that is what the navmesh is built for */
+	static FVector GetGoalLocation(const AActor* Goal);
+
+	bool IsPathStale(const FShooterSharedPath& Path, const FVector& GoalLocation, float WorldTime) const;
+
+	void QueueRequest(AActor* Goal, const FVector& Start);
+
+	void DispatchRequests();
+
+	void OnPathQueryFinished(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path);
+
+	void AddPath(AActor* Goal, const FVector& Start, FNavPathSharedPtr Path, bool bSuccess);
+
+	TMap<TWeakObjectPtr<AActor>, TArray<FShooterSharedPath>> Paths;
+
+	TArray<FShooterPathRequest> Requests;
+};
@@ -0,0 +1,217 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "World/ShooterSpatialHash.h"
+#include "ShooterPawnRegistry.generated.h"
+
+
+class APawn;
+
+
+UENUM()
+enum class EShooterPawnKind : uint8
+{
+	/* Controlled by a human player */
+	Player,
+
+	/* Zombies and other AI characters */
+	Bot,
+
+	VIP,
+
+	TrackerBot,
+
+	Num UMETA(Hidden)
+};
+
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnAlivePawnCountChanged, EShooterPawnKind /* Kind */, int32 /* NumAlive */);
+
+
+/* Pawns sharing kind, team and alive state, stored densely */
+USTRUCT()
+struct FShooterPawnBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<APawn*> Pawns;
+
+	EShooterPawnKind Kind;
+
+	int32 Team;
+
+	bool bAlive;
+
+	FShooterPawnBucket()
+		: Kind(EShooterPawnKind::Bot),
+		  Team(INDEX_NONE),
+		  bAlive(true)
+	{}
+};
+
+
+/**
+ * All pawns of the world grouped by kind, team and alive state. Pawns register themselves in BeginPlay/EndPlay
+ * and update their entry when they die or change controller, counts per kind are kept up to date so game rules
+ * don't have to scan the world. Living pawns are also kept in a spatial hash for proximity queries, their
+ * position is pushed from movement through UpdatePawnLocation.
+ */
+UCLASS()
+class PROTOTYPE_API UShooterPawnRegistry : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UShooterPawnRegistry();
+
+	virtual void Deinitialize() override;
+
+	void RegisterPawn(APawn* Pawn);
+
+	void UnregisterPawn(APawn* Pawn);
+
+	/* Re-evaluate kind, team and alive state of a registered pawn */
+	void UpdatePawn(APawn* Pawn);
+
+	int32 GetNumPawns() const
+	{
+		return PawnSlots.Num();
+	}
+
+	int32 GetNumPawns(EShooterPawnKind Kind, bool bAlive) const
+	{
+		return Counts[(int32)Kind][bAlive ? 1 : 0];
+	}
+
+	/* Fired after a register, unregister or update changed the number of living pawns of a kind */
+	FOnAlivePawnCountChanged OnAlivePawnCountChanged;
+
+	/* Calls Func(APawn*) for every registered pawn */
+	template<typename FuncType>
+	void ForEachPawn(FuncType Func) const
+	{
+		for (const FShooterPawnBucket& Bucket : Buckets)
+		{
+			for (APawn* Pawn : Bucket.Pawns)
+			{
+				Func(Pawn);
+			}
+		}
+	}
+
+	template<typename FuncType>
+	void ForEachPawn(EShooterPawnKind Kind, bool bAlive, FuncType Func) const
+	{
+		for (const FShooterPawnBucket& Bucket : Buckets)
+		{
+			if (Bucket.Kind == Kind && Bucket.bAlive == bAlive)
+			{
+				for (APawn* Pawn : Bucket.Pawns)
+				{
+					Func(Pawn);
+				}
+			}
+		}
+	}
+
+	/* Calls Func(APawn*) for every living pawn that is not on Team */
+	template<typename FuncType>
+	void ForEachAliveHostile(int32 Team, FuncType Func) const
+	{
+		for (const FShooterPawnBucket& Bucket : Buckets)
+		{
+			if (Bucket.bAlive && Bucket.Team != Team)
+			{
+				for (APawn* Pawn : Bucket.Pawns)
+				{
+					Func(Pawn);
+				}
+			}
+		}
+	}
+
+	/* First pawn of the kind in the given state, nullptr if there is none */
+	APawn* GetFirstPawn(EShooterPawnKind Kind, bool bAlive) const;
+
+	/* Team from the health component if there is one, otherwise from the player state */
+	static int32 GetPawnTeam(const APawn* Pawn);
+
+	/* Keeps the previous kind for pawns that lost their controller (eg. dead players) */
+	static EShooterPawnKind GetPawnKind(const APawn* Pawn, EShooterPawnKind PreviousKind);
+
+	static bool IsPawnAlive(const APawn* Pawn);
+
+	/************************************************************************/
+	/* Proximity queries                                                    */
+	/************************************************************************/
+
+	void UpdatePawnLocation(APawn* Pawn);
+
+	/* Calls Func(APawn*, float DistSq) for every living pawn within Radius */
+	template<typename FuncType>
+	void ForEachPawnInRadius(const FVector& Center, float Radius, int32 Team, EShooterTeamFilter Filter, FuncType Func) const
+	{
+		SpatialHash.ForEachInRadius(Center, Radius, Team, Filter, [&](int32 HashId, float DistSq)
+		{
+			Func(HashIdToPawn[HashId], DistSq);
+		});
+	}
+
+	/* Closest living pawn passing the team filter, nullptr if none is within MaxRadius */
+	APawn* FindNearestPawn(const FVector& Center, float MaxRadius, int32 Team, EShooterTeamFilter Filter, float* OutDistSq = nullptr) const;
+
+	/* Up to MaxResults closest living pawns, sorted by distance */
+	int32 FindNearestPawns(const FVector& Center, float MaxRadius, int32 Team, EShooterTeamFilter Filter, int32 MaxResults, TArray<APawn*>& OutPawns) const;
+
+	/* Whether a capsule at Center would overlap a living pawn */
+	bool IsCapsuleOverlappingPawn(const FVector& Center, float Radius, float HalfHeight, int32 Team = INDEX_NONE, EShooterTeamFilter Filter = EShooterTeamFilter::Any) const
+	{
+		return SpatialHash.OverlapsCapsule(Center, Radius, HalfHeight, Team, Filter);
+	}
+
+private:
+	struct FPawnSlot
+	{
+		int32 BucketIndex;
+
+		int32 Index;
+	};
+
+	int32 FindOrAddBucket(EShooterPawnKind Kind, int32 Team, bool bAlive);
+
+	void AddToBucket(APawn* Pawn, int32 BucketIndex);
+
+	/* Swap remove, patches the slot of the pawn moved into the gap */
+	void RemoveFromBucket(const FPawnSlot& Slot);
+
+	/* Adds living pawns to the spatial hash and removes dead ones */
+	void UpdateHashEntry(APawn* Pawn, int32 Team, bool bAlive);
+
+	void RemoveHashEntry(APawn* Pawn);
+
+	/* Broadcasts for every kind whose alive count differs from the snapshot */
+	void NotifyAliveCountChanges(const int32* OldAliveCounts);
+
+	void GetAliveCounts(int32* OutAliveCounts) const;
+
+	UPROPERTY(Transient)
+	TArray<FShooterPawnBucket> Buckets;
+
+	TMap<APawn*, FPawnSlot> PawnSlots;
+
+	/* Number of pawns per kind, dead [0] and alive [1] */
+	int32 Counts[(int32)EShooterPawnKind::Num][2];
+
+	FShooterSpatialHash SpatialHash;
+
+	/* Spatial hash ids are recycled to keep its slot array small */
+	TMap<APawn*, int32> PawnHashIds;
+
+	TArray<APawn*> HashIdToPawn;
+
+	TArray<int32> FreeHashIds;
+};
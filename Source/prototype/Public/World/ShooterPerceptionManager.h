@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "WorldCollision.h"
+#include "ShooterPerceptionManager.generated.h"
+
+
+class APawn;
+class AShooterZombieCharacter;
+
+
+/* Sensing state of the bots of one pass, packed per component and padded to a multiple of 4 for the vector loops */
+struct FShooterPerceptionBots
+{
+	TArray<AShooterZombieCharacter*> Bots;
+
+	/* Sense time of each bot before this pass, only noises made after it are heard */
+	TArray<float> PrevSenseTimes;
+
+	TArray<float> PosX;
+
+	TArray<float> PosY;
+
+	TArray<float> PosZ;
+
+	TArray<float> FwdX;
+
+	TArray<float> FwdY;
+
+	TArray<float> FwdZ;
+
+	/* Padding lanes are negative so no distance passes */
+	TArray<float> SightRadiusSq;
+
+	/* Cosine of the vision cone times its absolute value, compared against the signed square of the dot product */
+	TArray<float> SignedCosSq;
+
+	TArray<float> HearingSq;
+
+	TArray<float> LOSHearingSq;
+
+	void Reset();
+
+	void Add(AShooterZombieCharacter* Bot);
+
+	/* Fill the padding lanes of the last block */
+	void Pad();
+};
+
+
+/* Noise made by a player, either at the player or somewhere else (impacts) */
+struct FShooterPerceptionNoise
+{
+	APawn* Instigator;
+
+	FVector Location;
+
+	float Volume;
+
+	float Time;
+};
+
+
+/* Visibility trace in flight, the bot is told once it comes back unblocked */
+struct FShooterPerceptionTrace
+{
+	TWeakObjectPtr<AShooterZombieCharacter> Bot;
+
+	TWeakObjectPtr<APawn> Target;
+
+	/* Heard noise waiting for line of sight, sight check otherwise */
+	bool bNoise;
+
+	/* Trace end, the noise location for noise checks */
+	FVector TargetLocation;
+
+	float NoiseVolume;
+};
+
+
+/**
+ * Sight and hearing of all zombies in one pass instead of a sensing component per bot. Bots that are due, scaled by
+ * their significance tier, are packed into flat arrays and tested against every living player four at a time. The
+ * nearest player in each bot's vision cone and the nearest noise within line of sight hearing range are collected
+ * and checked with one batch of async visibility traces, results arrive in OnSeePlayer / OnHearNoise next frame.
+ * Runs on the server only.
+ */
+UCLASS()
+class PROTOTYPE_API UShooterPerceptionManager : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UShooterPerceptionManager();
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	/* FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+
+	virtual ETickableTickType GetTickableTickType() const override;
+
+	virtual bool IsTickable() const override;
+
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	void UpdatePerception(float WorldTime);
+
+	/* Nearest player in the vision cone of each bot, INDEX_NONE if none */
+	void FindSightCandidates(const TArray<APawn*>& Players, TArray<int32>& OutCandidates) const;
+
+	/* Nearest noise within the hearing threshold of each bot, otherwise the nearest one that needs line of sight */
+	void FindNoiseCandidates(TArray<int32>& OutHeard, TArray<int32>& OutCandidates) const;
+
+	void QueueTrace(AShooterZombieCharacter* Bot, APawn* Target, const FVector& TargetLocation, bool bNoise, float NoiseVolume);
+
+	void OnVisibilityTraceDone(const FTraceHandle& Handle, FTraceDatum& Datum);
+
+	FShooterPerceptionBots Batch;
+
+	/* Player noises made since the last pass */
+	TArray<FShooterPerceptionNoise> Noises;
+
+	TArray<FShooterPerceptionTrace> Traces;
+
+	FTraceDelegate TraceDelegate;
+
+	int32 NumPendingTraces;
+
+	float TimeUntilUpdate;
+};
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "ShooterReplicationGraph.generated.h"
+
+
+class AShooterWeapon;
+class AShooterCharacter;
+
+
+/* How actors of a class are routed into the graph */
+UENUM()
+enum class EShooterClassRepNodeMapping : uint8
+{
+	/* Not routed to a node, replicated through a connection specific node or as a dependent actor */
+	NotRouted,
+
+	/* Routed to the global always relevant node */
+	RelevantAllConnections,
+
+	/* Spatialized on the grid, never moves */
+	Spatialize_Static,
+
+	/* Spatialized on the grid, cell is updated every frame */
+	Spatialize_Dynamic,
+
+	/* Spatialized on the grid, treated as static while dormant and as dynamic while awake */
+	Spatialize_Dormancy,
+};
+
+
+/**
+ * Replication graph for the coop shooter. Pawns, tracker bots and projectiles are spatialized on a 2D grid, weapons
+ * only replicate as dependents of their owning character, the GameState is always relevant and PlayerStates are
+ * throttled through a frequency limiter. Pickups, barrels and powerups go through the dormancy aware grid routing,
+ * so they cost nothing while dormant.
+ */
+UCLASS(Transient, Config = Engine)
+class PROTOTYPE_API UShooterReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	UShooterReplicationGraph();
+
+	virtual void InitGlobalActorClassSettings() override;
+
+	virtual void InitGlobalGraphNodes() override;
+
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+
+	virtual void BeginDestroy() override;
+
+	/* Size of a grid cell in world units */
+	UPROPERTY(Config)
+	float GridCellSize;
+
+	/* Lower bounds of the grid, actors beyond are clamped into the border cells */
+	UPROPERTY(Config)
+	float SpatialBiasX;
+
+	UPROPERTY(Config)
+	float SpatialBiasY;
+
+	/* Update rate of the GameState, match time is computed locally so this only carries score and wave changes */
+	UPROPERTY(Config)
+	float GameStateNetUpdateFrequency;
+
+private:
+
+	EShooterClassRepNodeMapping GetMappingPolicy(UClass* Class);
+
+	EShooterClassRepNodeMapping GetDefaultMappingPolicy(const AActor* ActorCDO) const;
+
+	void InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class, bool bSpatialize, float NetUpdateFrequency) const;
+
+	void OnWeaponOwnerChanged(AShooterWeapon* Weapon, AShooterCharacter* OldOwner, AShooterCharacter* NewOwner);
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+	/* Explicit policies, classes not listed are resolved through their closest listed parent */
+	TClassMap<EShooterClassRepNodeMapping> ClassRepNodePolicies;
+
+	FDelegateHandle WeaponOwnerChangedHandle;
+};
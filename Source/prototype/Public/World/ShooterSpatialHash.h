@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+enum class EShooterTeamFilter : uint8
+{
+	Any,
+
+	SameTeam,
+
+	OtherTeam
+};
+
+
+/**
+ * Uniform 2D grid of entries identified by small integer ids. Each cell stores its entries as separate
+ * float arrays (x, y, z, radius, half height) so the distance tests in a query run over contiguous memory.
+ * Cells are found through a hash of their grid coordinates, empty cells are kept to avoid churn.
+ */
+class PROTOTYPE_API FShooterSpatialHash
+{
+public:
+	explicit FShooterSpatialHash(float InCellSize = 1000.0f);
+
+	void Add(int32 Id, const FVector& Location, int32 Team, float Radius, float HalfHeight);
+
+	void Remove(int32 Id);
+
+	/* Update the position, only moves between cells when the entry crossed a cell border */
+	void Move(int32 Id, const FVector& Location);
+
+	void SetTeam(int32 Id, int32 Team);
+
+	bool Contains(int32 Id) const
+	{
+		return EntrySlots.IsValidIndex(Id) && EntrySlots[Id].X != INDEX_NONE;
+	}
+
+	int32 Num() const
+	{
+		return NumEntries;
+	}
+
+	void Reset();
+
+	/* Calls Func(int32 Id, float DistSq) for every entry within Radius of Center */
+	template<typename FuncType>
+	void ForEachInRadius(const FVector& Center, float Radius, int32 Team, EShooterTeamFilter Filter, FuncType Func) const
+	{
+		const float RadiusSq = Radius * Radius;
+		ForEachCellInRange(Center, Radius, [&](const FCell& Cell)
+		{
+			const int32 NumInCell = Cell.Ids.Num();
+			const float* RESTRICT X = Cell.X.GetData();
+			const float* RESTRICT Y = Cell.Y.GetData();
+			const float* RESTRICT Z = Cell.Z.GetData();
+
+			for (int32 i = 0; i < NumInCell; i++)
+			{
+				const float DX = X[i] - Center.X;
+				const float DY = Y[i] - Center.Y;
+				const float DZ = Z[i] - Center.Z;
+				const float DistSq = DX * DX + DY * DY + DZ * DZ;
+
+				if (DistSq <= RadiusSq && PassesTeamFilter(Cell.Teams[i], Team, Filter))
+				{
+					Func(Cell.Ids[i], DistSq);
+				}
+			}
+		});
+	}
+
+	/* Up to MaxResults nearest entries within MaxRadius, sorted by distance. Returns the number found. */
+	int32 FindNearest(const FVector& Center, float MaxRadius, int32 Team, EShooterTeamFilter Filter, int32 MaxResults, int32* OutIds, float* OutDistSq = nullptr) const;
+
+	/* Same test spawn points use: vertical distance below twice the summed half heights, horizontal below the summed radii */
+	bool OverlapsCapsule(const FVector& Center, float Radius, float HalfHeight, int32 Team, EShooterTeamFilter Filter) const;
+
+	static bool PassesTeamFilter(int32 EntryTeam, int32 Team, EShooterTeamFilter Filter)
+	{
+		return Filter == EShooterTeamFilter::Any || ((EntryTeam == Team) == (Filter == EShooterTeamFilter::SameTeam));
+	}
+
+private:
+	struct FCell
+	{
+		FIntPoint Key;
+
+		TArray<float> X;
+
+		TArray<float> Y;
+
+		TArray<float> Z;
+
+		TArray<float> Radii;
+
+		TArray<float> HalfHeights;
+
+		TArray<int32> Teams;
+
+		TArray<int32> Ids;
+	};
+
+	FIntPoint GetCellKey(float X, float Y) const
+	{
+		return FIntPoint(FMath::FloorToInt(X * InvCellSize), FMath::FloorToInt(Y * InvCellSize));
+	}
+
+	int32 FindOrAddCell(const FIntPoint& Key);
+
+	void AddToCell(int32 Id, int32 CellIndex, const FVector& Location, int32 Team, float Radius, float HalfHeight);
+
+	void RemoveFromCell(int32 CellIndex, int32 SlotIndex);
+
+	/* Visits the cells overlapping the square around Center, or all cells if that is cheaper */
+	template<typename FuncType>
+	void ForEachCellInRange(const FVector& Center, float Range, FuncType Func) const
+	{
+		const FIntPoint MinKey = GetCellKey(Center.X - Range, Center.Y - Range);
+		const FIntPoint MaxKey = GetCellKey(Center.X + Range, Center.Y + Range);
+
+		const int64 NumKeys = int64(MaxKey.X - MinKey.X + 1) * int64(MaxKey.Y - MinKey.Y + 1);
+		if (NumKeys >= Cells.Num())
+		{
+			for (const FCell& Cell : Cells)
+			{
+				if (Cell.Ids.Num() > 0 && Cell.Key.X >= MinKey.X && Cell.Key.X <= MaxKey.X && Cell.Key.Y >= MinKey.Y && Cell.Key.Y <= MaxKey.Y)
+				{
+					Func(Cell);
+				}
+			}
+			return;
+		}
+
+		for (int32 CellY = MinKey.Y; CellY <= MaxKey.Y; CellY++)
+		{
+			for (int32 CellX = MinKey.X; CellX <= MaxKey.X; CellX++)
+			{
+				const int32* CellIndex = CellLookup.Find(FIntPoint(CellX, CellY));
+				if (CellIndex && Cells[*CellIndex].Ids.Num() > 0)
+				{
+					Func(Cells[*CellIndex]);
+				}
+			}
+		}
+	}
+
+	float CellSize;
+
+	float InvCellSize;
+
+	TArray<FCell> Cells;
+
+	TMap<FIntPoint, int32> CellLookup;
+
+	/* Per id: cell index (X) and index within the cell (Y), INDEX_NONE if not in the hash */
+	TArray<FIntPoint> EntrySlots;
+
+	int32 NumEntries;
+
+	/* Largest radius added, widens the cell range of capsule queries */
+	float MaxEntryRadius;
+};
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterWaypointRegistry.generated.h"
+
+
+class APawn;
+class AShooterBotWaypoint;
+
+
+USTRUCT()
+struct FShooterWaypointEntry
+{
+	GENERATED_BODY()
+
+	/* Navigable points sampled around the waypoint, patrol locations are drawn from them */
+	static const int32 MaxPatrolPoints = 8;
+
+	UPROPERTY()
+	AShooterBotWaypoint* Waypoint;
+
+	/* Waypoints don't move, the location is cached on registration */
+	FVector Location;
+
+	FVector PatrolPoints[MaxPatrolPoints];
+
+	int32 NumPatrolPoints;
+
+	FShooterWaypointEntry()
+		: Waypoint(nullptr),
+		  Location(FVector::ZeroVector),
+		  NumPatrolPoints(0)
+	{}
+};
+
+
+/**
+ * Bot waypoints of the world, registered in BeginPlay/EndPlay so patrolling bots don't have to search the actor list.
+ * The next waypoint is drawn from an alias table per source waypoint, weighted towards close waypoints, and
+ * rejected with a probability that grows with the number of pawns already around it. Tables are rebuilt when the
+ * set of waypoints changes, picking a waypoint or a patrol location doesn't allocate.
+ */
+UCLASS()
+class PROTOTYPE_API UShooterWaypointRegistry : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UShooterWaypointRegistry();
+
+	virtual void Deinitialize() override;
+
+	void RegisterWaypoint(AShooterBotWaypoint* Waypoint);
+
+	void UnregisterWaypoint(AShooterBotWaypoint* Waypoint);
+
+	int32 GetNumWaypoints() const
+	{
+		return Entries.Num();
+	}
+
+	/* Weighted random waypoint to move on to from CurrentWaypoint, or from the waypoint closest to Bot if it has none */
+	AShooterBotWaypoint* PickWaypoint(APawn* Bot, AActor* CurrentWaypoint);
+
+	/* Random pre-sampled navigable point around Waypoint, samples are taken on first use. False if there are none */
+	bool GetPatrolLocation(AActor* Waypoint, FVector& OutLocation);
+
+private:
+
+	void BuildAliasTables();
+
+	int32 FindNearestWaypoint(const FVector& Location) const;
+
+	/* Number of living pawns around the waypoint, not counting Bot */
+	int32 GetCrowding(int32 WaypointIdx, APawn* Bot) const;
+
+	void SamplePatrolPoints(FShooterWaypointEntry& Entry);
+
+	UPROPERTY(Transient)
+	TArray<FShooterWaypointEntry> Entries;
+
+	TMap<AActor*, int32> WaypointIndices;
+
+	/* One row of Entries.Num() columns per source waypoint: probability to keep the column, otherwise take its alias */
+	TArray<float> AliasProbs;
+
+	TArray<int32> AliasIndices;
+
+	bool bAliasTablesDirty;
+};
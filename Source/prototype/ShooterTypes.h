@@ -143,4 +143,50 @@ public:
 	{
 		EnsureReplicationByte++;
 	}
-};
\ No newline at end of file
+};
+
+/* Hit of a single pellet, kept small since a shot sends one per pellet */
+USTRUCT()
+struct FShooterPelletHit
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* Null when the pellet missed or hit unreferenced geometry */
+	UPROPERTY()
+	AActor* HitActor;
+
+	/* Bone on the hit actor's skeletal mesh, INDEX_NONE for anything else */
+	UPROPERTY()
+	int16 BoneIndex;
+
+	UPROPERTY()
+	FVector_NetQuantize ImpactPoint;
+
+	UPROPERTY()
+	bool bBlockingHit;
+
+	FShooterPelletHit()
+		: HitActor(nullptr),
+		BoneIndex(INDEX_NONE),
+		ImpactPoint(ForceInit),
+		bBlockingHit(false)
+	{}
+};
+
+
+/* All pellet hits of one shot */
+USTRUCT()
+struct FShooterPelletHitBatch
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	TArray<FShooterPelletHit> Hits;
+
+	FShooterPelletHitBatch()
+		: Origin(ForceInit)
+	{}
+};
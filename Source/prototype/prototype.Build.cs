@@ -18,7 +18,9 @@ public class prototype : ModuleRules
 			"OnlineSubsystem",
 			"OnlineSubsystemUtils",
 			"PhysicsCore", 
-			"NavigationSystem" 
+			"NavigationSystem",
+			"NetCore",
+			"ReplicationGraph"
 		});
 
 		PrivateDependencyModuleNames.AddRange(new string[] {  });
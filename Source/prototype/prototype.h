@@ -18,4 +18,9 @@ DEFINE_LOG_CATEGORY_STATIC(LogGame, Log, All);
 #define SURFACE_ZOMBIEHEAD			SurfaceType4
 #define SURFACE_ZOMBIELIMB			SurfaceType5
 
-#define COLLISION_WEAPON			ECC_GameTraceChannel1
\ No newline at end of file
+#define COLLISION_WEAPON			ECC_GameTraceChannel1
+
+/* Stat groups, use "stat ShooterNet" etc. in the console */
+DECLARE_STATS_GROUP(TEXT("ShooterNet"), STATGROUP_ShooterNet, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("ShooterHitReg"), STATGROUP_ShooterHitReg, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("ShooterAI"), STATGROUP_ShooterAI, STATCAT_Advanced);
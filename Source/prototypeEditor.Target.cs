@@ -10,5 +10,8 @@ public class prototypeEditorTarget : TargetRules
 		Type = TargetType.Editor;
 		DefaultBuildSettings = BuildSettingsVersion.V2;
 		ExtraModuleNames.AddRange( new string[] { "prototype" } );
+
+		// No push model here, the editor shares the engine's build environment. MARK_PROPERTY_DIRTY compiles out and
+		// properties are compared as usual, the Game and Server targets enable it
 	}
 }